@@ -0,0 +1,68 @@
+#include <raylib.h>
+#include "UIComponents.cpp"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+// Bakes fonts and images into a pack that AssetPack maps at startup, so the
+// application never rasterizes a TTF or decodes a PNG on the device.
+//   AssetPacker <out.pack> font <name> <file.ttf> <size> [glyphs]
+//                          image <name> <file> [format] [mipmaps]
+// format is a raylib PixelFormat value; 0 keeps the source format. main.cpp
+// looks for the pack built by
+//   AssetPacker res/ui.pack font RedHatMono-Medium res/RedHatMono-Medium.ttf 20 250
+
+static bool isNumber(int i,int argc,char** argv){
+    return i < argc && isdigit((unsigned char)argv[i][0]);
+}
+
+static void usage(){
+    cout << "Usage: AssetPacker <out.pack> [font <name> <file.ttf> <size> [glyphs]] [image <name> <file> [format] [mipmaps]]..." << endl;
+}
+
+int main(int argc,char** argv){
+    if(argc < 3){
+        usage();
+        return 1;
+    }
+    AssetPackBuilder builder;
+    int i = 2;
+    while(i < argc){
+        string kind = argv[i];
+        if(kind == "font" && i + 3 < argc){
+            const char* name = argv[i + 1];
+            const char* file = argv[i + 2];
+            int size = atoi(argv[i + 3]);
+            i += 4;
+            int glyphs = 95;
+            if(isNumber(i,argc,argv))
+                glyphs = atoi(argv[i++]);
+            if(!builder.addFont(name,file,size,glyphs))
+                return 1;
+        } else if(kind == "image" && i + 2 < argc){
+            const char* name = argv[i + 1];
+            const char* file = argv[i + 2];
+            i += 3;
+            int format = 0;
+            bool mipmaps = false;
+            if(isNumber(i,argc,argv))
+                format = atoi(argv[i++]);
+            if(i < argc && strcmp(argv[i],"mipmaps") == 0){
+                mipmaps = true;
+                i++;
+            }
+            if(!builder.addImage(name,file,format,mipmaps))
+                return 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(!builder.write(argv[1])){
+        cout << "Error: " << argv[1] << " could not be written" << endl;
+        return 1;
+    }
+    return 0;
+}
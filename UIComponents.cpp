@@ -1,5 +1,14 @@
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <typeinfo>
 #include "UIComponents.h"
 #include <queue>
 #include <algorithm>
@@ -7,23 +16,94 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#if defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-Font font;
+RaylibRenderer raylib_renderer;
+RaylibInput raylib_input;
+UIContext default_context;
+thread_local UIContext* context = &default_context;
+thread_local AllocationTracker* allocation_tracker = nullptr;
+
+// Replacing the global allocation functions would clash with any other
+// allocator a program links, so counting is opt-in.
+#ifdef UI_ALLOCATION_TRACKING
+#if !defined(NDEBUG) && (defined(__GNUC__) || defined(__clang__))
+#define ALLOCATION_SITE __builtin_return_address(0)
+#else
+#define ALLOCATION_SITE nullptr
+#endif
+
+static inline void* trackedAlloc(size_t size,void* site){
+    void* p = malloc(size == 0 ? 1 : size);
+    if(p == nullptr)
+        throw bad_alloc();
+    if(allocation_tracker != nullptr)
+        allocation_tracker->record(size,site);
+    return p;
+}
+
+static inline void trackedFree(void* p){
+    if(p != nullptr && allocation_tracker != nullptr)
+        allocation_tracker->frame.frees++;
+    free(p);
+}
+
+void* operator new(size_t size){
+    return trackedAlloc(size,ALLOCATION_SITE);
+}
+
+void* operator new[](size_t size){
+    return trackedAlloc(size,ALLOCATION_SITE);
+}
+
+void operator delete(void* p) noexcept{
+    trackedFree(p);
+}
+
+void operator delete[](void* p) noexcept{
+    trackedFree(p);
+}
+
+void operator delete(void* p,size_t size) noexcept{
+    trackedFree(p);
+}
+
+void operator delete[](void* p,size_t size) noexcept{
+    trackedFree(p);
+}
+#endif
 
-int KeyboardListener::last_char = 0;
-KeyboardListener* KeyboardListener::focus = nullptr;
-Draggable* Draggable::focus = nullptr;
-int UIComponent::id_counter = 0;
 Color UIComponent::default_background_color = RAYWHITE;
 Color UIComponent::primary_color = LIGHTGRAY;
 Color UIComponent::secondary_color = DARKGRAY;
+atomic<long> UIComponent::live_count(0);
+atomic<long> Style::live_count(0);
+atomic<long> Timer::live_count(0);
+atomic<long> Binding::live_count(0);
+const char* MemoryReport::category_names[MEMORY_CATEGORY_COUNT] = {"components","styles","strings","callbacks","textures","buffers"};
+const char* AllocationTracker::phase_names[PHASE_COUNT] = {"input","update","draw","other"};
 Color Button::hover_color = GRAY;
 int TitleBar::title_bar_height = 20;
-int TextBox::repeat_delay = 12;
-int TextBox::start_delay = 15;
-map<char,char> TextBox::shift_map = {{'1','!'},{'2','@'},{'3','#'},{'4','$'},{'5','%'},{'6','^'},{'7','&'},{'8','*'},{'9','('},{'0',')'},
+float Window::resize_margin = 6;
+Vector2 Window::min_size = {120,60};
+double TextBox::repeat_delay = .2;
+double TextBox::start_delay = .25;
+double TextBox::blink_interval = .5;
+double TextArea::repeat_delay = .05;
+double TextArea::start_delay = .25;
+double TextArea::blink_interval = .5;
+int TextArea::tab_width = 4;
+map<char,char> KeyboardListener::shift_map = {{'1','!'},{'2','@'},{'3','#'},{'4','$'},{'5','%'},{'6','^'},{'7','&'},{'8','*'},{'9','('},{'0',')'},
                                      {'-','_'},{'=','+'},{'[','{'},{']','}'},{'\\','|'},{';',':'},{'\'','"'},{',','<'},{'.','>'},{'/','?'}};
 Color CheckBox::checked_color = BLUE;
 Color CheckBox::unchecked_color = UIComponent::default_background_color;
@@ -31,101 +111,639 @@ Color CheckBox::hover_margin_color = BLACK;
 Color CheckBox::default_margin_color = UIComponent::secondary_color;
 Color Slider::background_color = UIComponent::primary_color;
 Color Slider::slider_color = UIComponent::secondary_color;
-
-struct CompareMouseListeners{
-    bool operator()(MouseListener* l1,MouseListener* l2){
-        return l1->listener_parent->z_index < l2->listener_parent->z_index;
+Color DataGrid::header_color = UIComponent::primary_color;
+Color DataGrid::grid_color = UIComponent::primary_color;
+Color DataGrid::selected_color = SKYBLUE;
+Color TreeView::selected_color = SKYBLUE;
+float TreeView::indent = 16;
+size_t Layer::budget = 64 << 20;
+
+// Stable insertion sort: z order rarely changes between frames, so this is
+// linear in practice and, unlike a heap, reuses the caller's buffer.
+template<class T,class Key>
+void sortByZ(vector<T>& v,Key z){
+    for(size_t i = 1; i < v.size(); i++){
+        T item = v[i];
+        size_t j = i;
+        for(; j > 0 && z(v[j - 1]) > z(item); j--)
+            v[j] = v[j - 1];
+        v[j] = item;
     }
-};
+}
 
-struct CompareUIComponents{
-    bool operator()(UIComponent* c1,UIComponent* c2){
-        return c1->z_index > c2->z_index;
+template<class T,class Compare>
+void parallelSort(vector<T>& v,Compare less){
+    size_t n = v.size();
+    size_t chunks = 1;
+    while(chunks * 2 <= thread::hardware_concurrency() && n / (chunks * 2) >= 16384)
+        chunks *= 2;
+    size_t chunk = (n + chunks - 1) / chunks;
+    vector<thread> workers;
+    for(size_t i = 1; i < chunks; i++)
+        workers.emplace_back([&v,&less,i,chunk,n](){
+            sort(v.begin() + min(i * chunk,n),v.begin() + min((i + 1) * chunk,n),less);
+        });
+    sort(v.begin(),v.begin() + min(chunk,n),less);
+    for(thread& t : workers)
+        t.join();
+    for(size_t width = chunk; width < n; width *= 2){
+        workers.clear();
+        for(size_t start = 0; start + width < n; start += 2 * width){
+            workers.emplace_back([&v,&less,start,width,n](){
+                inplace_merge(v.begin() + start,v.begin() + start + width,v.begin() + min(start + 2 * width,n),less);
+            });
+        }
+        for(thread& t : workers)
+            t.join();
     }
-};
+}
 
 void setScissor(Rectangle r){
-    if(!scissor_stack.empty()){
-        int x = max((int)r.x,(int)scissor_stack.top().x);
-        int y = max((int)r.y,(int)scissor_stack.top().y);
-        int width = min((int)r.width+r.x,(int)scissor_stack.top().width+scissor_stack.top().x) - x;
-        int height = min((int)r.height+r.y,(int)scissor_stack.top().height+scissor_stack.top().y) - y;
+    if(!context->scissor_stack.empty()){
+        int x = max((int)r.x,(int)context->scissor_stack.top().x);
+        int y = max((int)r.y,(int)context->scissor_stack.top().y);
+        int width = min((int)r.width+r.x,(int)context->scissor_stack.top().width+context->scissor_stack.top().x) - x;
+        int height = min((int)r.height+r.y,(int)context->scissor_stack.top().height+context->scissor_stack.top().y) - y;
+        width = max(width,0);
+        height = max(height,0);
         r = Rectangle{static_cast<float>(x),static_cast<float>(y),static_cast<float>(width),static_cast<float>(height)};
     }
-    BeginScissorMode((int)r.x,(int)r.y,(int)r.width,(int)r.height);
-    scissor_stack.push(r);
+    context->renderer->beginScissor(r);
+    context->scissor_stack.push(r);
 }
 
 void endScissor(){
-    Rectangle r = scissor_stack.top();
-    scissor_stack.pop();
-    if(scissor_stack.empty())
-        EndScissorMode();
+    context->scissor_stack.pop();
+    if(context->scissor_stack.empty())
+        context->renderer->endScissor();
     else{
-        Rectangle r = scissor_stack.top();
-        BeginScissorMode((int)r.x,(int)r.y,(int)r.width,(int)r.height);
+        Rectangle r = context->scissor_stack.top();
+        context->renderer->beginScissor(r);
     }
 }
 
-void startGameLoop(){
-    Vector2 last_mouse_pos = GetMousePosition();
-    Vector2 drag_origin = {-1,-1};
-    int drag_button = -1;
-    while(!WindowShouldClose()){
-        root->Update();
-        int key = GetKeyPressed();
-        Vector2 mouse_pos = GetMousePosition();
-        root->onHover(mouse_pos);
-        if(IsMouseButtonPressed(MOUSE_LEFT_BUTTON)){
-            drag_origin = mouse_pos;
-            drag_button = MOUSE_LEFT_BUTTON;
-            root->onClick(mouse_pos,MOUSE_LEFT_BUTTON);
+void DrawTextureToScreenCoords(Texture t,Vector2 pos,Vector2 dim){
+    context->renderer->drawTexture(t,Rectangle{0,0,(float)t.width,(float)t.height},Rectangle{pos.x,pos.y,dim.x,dim.y},WHITE);
+}
+
+void renderFrame(Color clear){
+    context->mutations.commit();
+    context->renderer->beginFrame(clear);
+    context->root->UIDraw();
+    context->renderer->endFrame();
+}
+
+float glyphAdvance(int codepoint,float font_size,float spacing){
+    int index = GetGlyphIndex(context->font,codepoint);
+    float scale = font_size / context->font.baseSize;
+    float advance = context->font.glyphs[index].advanceX == 0 ? context->font.recs[index].width : context->font.glyphs[index].advanceX;
+    return advance * scale + spacing;
+}
+
+void minMaxKernel(const float* lo,const float* hi,size_t n,float& mn,float& mx){
+    size_t i = 0;
+#if defined(__AVX__)
+    if(n >= 8){
+        __m256 vmin = _mm256_loadu_ps(lo);
+        __m256 vmax = _mm256_loadu_ps(hi);
+        for(i = 8; i + 8 <= n; i += 8){
+            vmin = _mm256_min_ps(vmin,_mm256_loadu_ps(lo + i));
+            vmax = _mm256_max_ps(vmax,_mm256_loadu_ps(hi + i));
+        }
+        float out_min[8],out_max[8];
+        _mm256_storeu_ps(out_min,vmin);
+        _mm256_storeu_ps(out_max,vmax);
+        for(int k = 0; k < 8; k++){
+            mn = min(mn,out_min[k]);
+            mx = max(mx,out_max[k]);
+        }
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    if(n >= 4){
+        __m128 vmin = _mm_loadu_ps(lo);
+        __m128 vmax = _mm_loadu_ps(hi);
+        for(i = 4; i + 4 <= n; i += 4){
+            vmin = _mm_min_ps(vmin,_mm_loadu_ps(lo + i));
+            vmax = _mm_max_ps(vmax,_mm_loadu_ps(hi + i));
         }
-        if(IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)){
-            drag_origin = mouse_pos;
-            drag_button = MOUSE_RIGHT_BUTTON;
-            root->onClick(mouse_pos,MOUSE_RIGHT_BUTTON);
+        float out_min[4],out_max[4];
+        _mm_storeu_ps(out_min,vmin);
+        _mm_storeu_ps(out_max,vmax);
+        for(int k = 0; k < 4; k++){
+            mn = min(mn,out_min[k]);
+            mx = max(mx,out_max[k]);
         }
+    }
+#endif
+    for(; i < n; i++){
+        mn = min(mn,lo[i]);
+        mx = max(mx,hi[i]);
+    }
+}
+
+void globalRectsKernel(const float* x,const float* y,size_t n,Vector2 origin,float* out_x,float* out_y){
+    size_t i = 0;
+#if defined(__AVX__)
+    __m256 ox = _mm256_set1_ps(origin.x);
+    __m256 oy = _mm256_set1_ps(origin.y);
+    for(; i + 8 <= n; i += 8){
+        _mm256_storeu_ps(out_x + i,_mm256_add_ps(_mm256_loadu_ps(x + i),ox));
+        _mm256_storeu_ps(out_y + i,_mm256_add_ps(_mm256_loadu_ps(y + i),oy));
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 ox = _mm_set1_ps(origin.x);
+    __m128 oy = _mm_set1_ps(origin.y);
+    for(; i + 4 <= n; i += 4){
+        _mm_storeu_ps(out_x + i,_mm_add_ps(_mm_loadu_ps(x + i),ox));
+        _mm_storeu_ps(out_y + i,_mm_add_ps(_mm_loadu_ps(y + i),oy));
+    }
+#endif
+    for(; i < n; i++){
+        out_x[i] = x[i] + origin.x;
+        out_y[i] = y[i] + origin.y;
+    }
+}
 
-        if(IsMouseButtonDown(MOUSE_LEFT_BUTTON) && drag_button == MOUSE_LEFT_BUTTON){
-            if(Draggable::focus != nullptr)
-                Draggable::focus->onDrag(drag_origin,{mouse_pos.x - drag_origin.x,mouse_pos.y - drag_origin.y},MOUSE_LEFT_BUTTON);
+// Same test as CheckCollisionPointRec: left/top edges inclusive, right/bottom exclusive.
+size_t pointInRectsKernel(const float* x,const float* y,const float* w,const float* h,size_t n,Vector2 point,unsigned char* hits){
+    size_t i = 0;
+    size_t count = 0;
+#if defined(__AVX__)
+    __m256 px = _mm256_set1_ps(point.x);
+    __m256 py = _mm256_set1_ps(point.y);
+    for(; i + 8 <= n; i += 8){
+        __m256 rx = _mm256_loadu_ps(x + i);
+        __m256 ry = _mm256_loadu_ps(y + i);
+        __m256 in_x = _mm256_and_ps(_mm256_cmp_ps(px,rx,_CMP_GE_OQ),_mm256_cmp_ps(px,_mm256_add_ps(rx,_mm256_loadu_ps(w + i)),_CMP_LT_OQ));
+        __m256 in_y = _mm256_and_ps(_mm256_cmp_ps(py,ry,_CMP_GE_OQ),_mm256_cmp_ps(py,_mm256_add_ps(ry,_mm256_loadu_ps(h + i)),_CMP_LT_OQ));
+        int bits = _mm256_movemask_ps(_mm256_and_ps(in_x,in_y));
+        for(int k = 0; k < 8; k++){
+            hits[i + k] = (bits >> k) & 1;
+            count += hits[i + k];
         }
-        if(IsMouseButtonDown(MOUSE_RIGHT_BUTTON) && drag_button == MOUSE_RIGHT_BUTTON){
-            if(Draggable::focus != nullptr)
-                Draggable::focus->onDrag(drag_origin,{mouse_pos.x - drag_origin.x,mouse_pos.y - drag_origin.y},MOUSE_RIGHT_BUTTON);
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 px = _mm_set1_ps(point.x);
+    __m128 py = _mm_set1_ps(point.y);
+    for(; i + 4 <= n; i += 4){
+        __m128 rx = _mm_loadu_ps(x + i);
+        __m128 ry = _mm_loadu_ps(y + i);
+        __m128 in_x = _mm_and_ps(_mm_cmpge_ps(px,rx),_mm_cmplt_ps(px,_mm_add_ps(rx,_mm_loadu_ps(w + i))));
+        __m128 in_y = _mm_and_ps(_mm_cmpge_ps(py,ry),_mm_cmplt_ps(py,_mm_add_ps(ry,_mm_loadu_ps(h + i))));
+        int bits = _mm_movemask_ps(_mm_and_ps(in_x,in_y));
+        for(int k = 0; k < 4; k++){
+            hits[i + k] = (bits >> k) & 1;
+            count += hits[i + k];
+        }
+    }
+#endif
+    for(; i < n; i++){
+        hits[i] = point.x >= x[i] && point.x < x[i] + w[i] && point.y >= y[i] && point.y < y[i] + h[i];
+        count += hits[i];
+    }
+    return count;
+}
+
+size_t clipRectsKernel(const float* x,const float* y,const float* w,const float* h,size_t n,Rectangle clip,unsigned char* visible){
+    size_t i = 0;
+    size_t count = 0;
+    float right = clip.x + clip.width;
+    float bottom = clip.y + clip.height;
+#if defined(__AVX__)
+    __m256 cx = _mm256_set1_ps(clip.x);
+    __m256 cy = _mm256_set1_ps(clip.y);
+    __m256 cr = _mm256_set1_ps(right);
+    __m256 cb = _mm256_set1_ps(bottom);
+    for(; i + 8 <= n; i += 8){
+        __m256 rx = _mm256_loadu_ps(x + i);
+        __m256 ry = _mm256_loadu_ps(y + i);
+        __m256 in_x = _mm256_and_ps(_mm256_cmp_ps(rx,cr,_CMP_LT_OQ),_mm256_cmp_ps(_mm256_add_ps(rx,_mm256_loadu_ps(w + i)),cx,_CMP_GT_OQ));
+        __m256 in_y = _mm256_and_ps(_mm256_cmp_ps(ry,cb,_CMP_LT_OQ),_mm256_cmp_ps(_mm256_add_ps(ry,_mm256_loadu_ps(h + i)),cy,_CMP_GT_OQ));
+        int bits = _mm256_movemask_ps(_mm256_and_ps(in_x,in_y));
+        for(int k = 0; k < 8; k++){
+            visible[i + k] = (bits >> k) & 1;
+            count += visible[i + k];
+        }
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 cx = _mm_set1_ps(clip.x);
+    __m128 cy = _mm_set1_ps(clip.y);
+    __m128 cr = _mm_set1_ps(right);
+    __m128 cb = _mm_set1_ps(bottom);
+    for(; i + 4 <= n; i += 4){
+        __m128 rx = _mm_loadu_ps(x + i);
+        __m128 ry = _mm_loadu_ps(y + i);
+        __m128 in_x = _mm_and_ps(_mm_cmplt_ps(rx,cr),_mm_cmpgt_ps(_mm_add_ps(rx,_mm_loadu_ps(w + i)),cx));
+        __m128 in_y = _mm_and_ps(_mm_cmplt_ps(ry,cb),_mm_cmpgt_ps(_mm_add_ps(ry,_mm_loadu_ps(h + i)),cy));
+        int bits = _mm_movemask_ps(_mm_and_ps(in_x,in_y));
+        for(int k = 0; k < 4; k++){
+            visible[i + k] = (bits >> k) & 1;
+            count += visible[i + k];
         }
+    }
+#endif
+    for(; i < n; i++){
+        visible[i] = x[i] < right && x[i] + w[i] > clip.x && y[i] < bottom && y[i] + h[i] > clip.y;
+        count += visible[i];
+    }
+    return count;
+}
+
+void RectArray::resize(size_t n){
+    x.resize(n);
+    y.resize(n);
+    w.resize(n);
+    h.resize(n);
+    mask.resize(n);
+}
+
+size_t RectArray::size(){
+    return x.size();
+}
+
+size_t RectArray::heapBytes(){
+    return (x.capacity() + y.capacity() + w.capacity() + h.capacity()) * sizeof(float) + mask.capacity();
+}
+
+void startGameLoop(){
+    context->loop.fixed_step = false;
+    context->loop.run();
+}
+
+void startFixedStepLoop(double update_rate,double render_rate){
+    context->loop.fixed_step = true;
+    context->loop.update_rate = update_rate;
+    context->loop.render_rate = render_rate;
+    context->loop.run();
+}
+
+GameLoop::GameLoop(){
+    fixed_step = false;
+    update_rate = 60;
+    render_rate = 0;
+    max_steps = 5;
+    alpha = 1;
+    steps = 0;
+    update_ms = 0;
+    render_ms = 0;
+    mouse_pos = {0,0};
+    pressed[0] = pressed[1] = false;
+    down[0] = down[1] = false;
+    drag_origin = {-1,-1};
+    drag_button = -1;
+    low_latency = false;
+    idle_poll = .008;
+    input_seen = true;
+}
 
-        if(!IsMouseButtonDown(MOUSE_LEFT_BUTTON) && drag_button == MOUSE_LEFT_BUTTON 
-        || !IsMouseButtonDown(MOUSE_RIGHT_BUTTON) && drag_button == MOUSE_RIGHT_BUTTON){
+void GameLoop::pollInput(){
+    context->allocations.setPhase(PHASE_INPUT);
+    context->input->poll();
+    sampleInput();
+}
+
+void GameLoop::sampleInput(){
+    Vector2 last = mouse_pos;
+    mouse_pos = context->input->mousePosition();
+    input_seen = mouse_pos.x != last.x || mouse_pos.y != last.y || context->input->mouseWheelMove() != 0;
+    for(int b = 0; b < 2; b++){
+        pressed[b] = pressed[b] || context->input->isMouseButtonPressed(b);
+        down[b] = context->input->isMouseButtonDown(b);
+        input_seen = input_seen || pressed[b] || down[b];
+    }
+    for(int key = context->input->keyPressed(); key != 0; key = context->input->keyPressed())
+        keys.push_back(key);
+    input_seen = input_seen || !keys.empty();
+    if(context->keyboard_focus != nullptr && context->last_char != 0)
+        input_seen = input_seen || context->input->isKeyDown(context->last_char);
+}
+
+// A frame is idle when it saw no input, nothing ticks and nothing was
+// invalidated; the next frame would draw the same thing.
+bool GameLoop::idle(){
+    return !input_seen && !context->redraw && context->tick_list.empty() && context->command_queue.empty();
+}
+
+// Sleeps until the next timer or animation deadline, or until input or a
+// worker command arrives when nothing is scheduled. The wait is taken in
+// idle_poll slices so commands posted by other threads are picked up.
+void GameLoop::waitIdle(){
+    double deadline = context->scheduler.nextDeadline();
+    while(!context->input->done() && context->command_queue.empty()){
+        double slice = idle_poll;
+        if(deadline >= 0)
+            slice = min(slice,deadline - context->input->time());
+        if(slice <= 0 || context->input->wait(slice))
+            return;
+    }
+}
+
+// Re-samples the pointer just before drawing and moves whatever is being
+// dragged to it, so a dragged window or slider tracks the cursor of this
+// frame instead of the one sampled before update. Only position and held
+// buttons are read; press edges and keys belong to the frame that polled
+// them, and the source carries any that arrive during latch() into the next.
+void GameLoop::latchPointer(){
+    context->allocations.setPhase(PHASE_INPUT);
+    context->input->latch();
+    mouse_pos = context->input->mousePosition();
+    for(int b = 0; b < 2; b++)
+        down[b] = context->input->isMouseButtonDown(b);
+    if(drag_button >= 0 && context->drag_focus != nullptr){
+        int b = drag_button == MOUSE_LEFT_BUTTON ? 0 : 1;
+        if(down[b])
+            context->drag_focus->onDrag(drag_origin,{mouse_pos.x - drag_origin.x,mouse_pos.y - drag_origin.y},(MouseButton)drag_button);
+    }
+    context->mutations.commit();
+    context->allocations.setPhase(PHASE_OTHER);
+}
+
+void GameLoop::update(double now){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    context->allocations.setPhase(PHASE_UPDATE);
+    if(context->command_queue.drain() > 0)
+        MouseListener::invalidateHover();
+    if(fixed_step){
+        context->scheduler.now = now;
+        context->scheduler.timers.advance(now);
+    } else
+        context->scheduler.advance(now);
+    UIComponent::tickAll();
+    context->allocations.setPhase(PHASE_INPUT);
+    MouseListener::updateHover(context->root,mouse_pos);
+    const MouseButton buttons[2] = {MOUSE_LEFT_BUTTON,MOUSE_RIGHT_BUTTON};
+    for(int b = 0; b < 2; b++){
+        if(!pressed[b])
+            continue;
+        pressed[b] = false;
+        drag_origin = mouse_pos;
+        drag_button = buttons[b];
+        context->root->onClick(mouse_pos,buttons[b]);
+        MouseListener::invalidateHover();
+    }
+    for(int b = 0; b < 2; b++){
+        if(drag_button != buttons[b])
+            continue;
+        if(down[b]){
+            if(context->drag_focus != nullptr)
+                context->drag_focus->onDrag(drag_origin,{mouse_pos.x - drag_origin.x,mouse_pos.y - drag_origin.y},buttons[b]);
+        } else {
             drag_origin = {-1,-1};
             drag_button = -1;
-            Draggable::focus = nullptr;
-        } 
-        
-        if(KeyboardListener::focus != nullptr)
-            KeyboardListener::focus->HandleKey(key);
-        BeginDrawing();
-        ClearBackground(WHITE);
-        root->UIDraw();
-        EndDrawing();
+            context->drag_focus = nullptr;
+        }
     }
-    CloseWindow();
+    if(keys.empty() && context->keyboard_focus != nullptr)
+        context->keyboard_focus->HandleKey(0);
+    for(int key : keys)
+        if(context->keyboard_focus != nullptr)
+            context->keyboard_focus->HandleKey(key);
+    keys.clear();
+    context->allocations.setPhase(PHASE_UPDATE);
+    context->mutations.commit();
+    ObservableBase::flush();
+    context->allocations.setPhase(PHASE_OTHER);
+    update_ms = chrono::duration<double,milli>(chrono::steady_clock::now() - start).count();
+}
+
+// interpolate_callback gets alpha, the fraction of the current fixed step
+// that has elapsed, so state that only changes on steps can be drawn between
+// its last two values. Outside fixed-step mode alpha is always 1.
+void GameLoop::render(double now){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    context->allocations.setPhase(PHASE_DRAW);
+    if(fixed_step)
+        context->scheduler.animator.advance(now);
+    if(interpolate_callback)
+        interpolate_callback(alpha);
+    renderFrame();
+    context->allocations.setPhase(PHASE_OTHER);
+    render_ms = chrono::duration<double,milli>(chrono::steady_clock::now() - start).count();
+}
+
+void GameLoop::run(){
+    double step = 1 / update_rate;
+    double next_update = context->input->time();
+    double next_render = next_update;
+    if(fixed_step)
+        context->renderer->setTargetFPS(0);
+    while(!context->input->done()){
+        context->allocations.endFrame();
+        context->allocations.beginFrame();
+        pollInput();
+        double now = context->input->time();
+        if(!fixed_step){
+            steps = 1;
+            alpha = 1;
+            context->redraw = false;
+            update(now);
+            if(low_latency)
+                latchPointer();
+            render(now);
+            if(idle())
+                waitIdle();
+            continue;
+        }
+        steps = 0;
+        while(now >= next_update && steps < max_steps){
+            update(next_update);
+            next_update += step;
+            steps++;
+        }
+        if(now >= next_update)
+            next_update = now + step;
+        if(render_rate <= 0 || now >= next_render){
+            alpha = max(0.0,min(1.0,1 - (next_update - now) / step));
+            if(low_latency)
+                latchPointer();
+            render(now);
+            if(render_rate > 0){
+                next_render += 1 / render_rate;
+                if(next_render < now)
+                    next_render = now + 1 / render_rate;
+            }
+        } else {
+            context->input->wait(min(next_update,next_render) - context->input->time());
+        }
+    }
+    context->renderer->close();
+}
+
+
+Binding::Binding(){
+    source = nullptr;
+    id = -1;
+    live_count++;
+}
+
+Binding::~Binding(){
+    release();
+    live_count--;
+}
+
+bool Binding::bound(){
+    return source != nullptr;
+}
+
+void Binding::release(){
+    if(source == nullptr)
+        return;
+    source->unsubscribe(id);
+    source->detach(this);
+    source = nullptr;
+}
+
+ObservableBase::ObservableBase(){
+    context = ::context;
+    queued = false;
+    next_id = 0;
+}
+
+ObservableBase::~ObservableBase(){
+    for(Binding* b : bindings)
+        b->source = nullptr;
+    if(queued)
+        replace(context->dirty_observables.begin(),context->dirty_observables.end(),this,(ObservableBase*)nullptr);
 }
 
+void ObservableBase::schedule(){
+    if(queued)
+        return;
+    queued = true;
+    context->dirty_observables.push_back(this);
+}
+
+void ObservableBase::attach(Binding* binding,int id){
+    binding->source = this;
+    binding->id = id;
+    bindings.push_back(binding);
+}
+
+void ObservableBase::detach(Binding* binding){
+    bindings.erase(remove(bindings.begin(),bindings.end(),binding),bindings.end());
+}
+
+void ObservableBase::flush(){
+    UIContext* ui = ::context;
+    for(size_t i = 0; i < ui->dirty_observables.size(); i++){
+        ObservableBase* o = ui->dirty_observables[i];
+        if(o == nullptr)
+            continue;
+        o->queued = false;
+        o->publish();
+    }
+    ui->dirty_observables.clear();
+}
 
+// A component belongs to the context current when it is created and uses it
+// from then on, so destroying or stopping it from another thread still
+// unregisters it from the right context.
 UIComponent::UIComponent(UIComponent* parent,Vector2 offset,Vector2 dimension){
+    this->context = ::context;
     this->parent = parent;
     this->offset = offset;
     this->dimension = dimension;
-    this->id = id_counter++;
+    this->id = context->id_counter++;
     this->z_index = 0;
+    this->tick_index = -1;
+    this->layer = nullptr;
     show = true;
+    static_storage = false;
+    live_count++;
+}
+
+void UIComponent::release(UIComponent* c){
+    if(!c->static_storage)
+        delete c;
 }
 
 UIComponent::~UIComponent(){
+    live_count--;
+    stopTicking();
     for(auto s : styles)
-        delete s;
+        Style::release(s);
+}
+
+void UIComponent::startTicking(){
+    if(tick_index != -1)
+        return;
+    tick_index = context->tick_list.size();
+    context->tick_list.push_back(this);
+}
+
+void UIComponent::stopTicking(){
+    if(tick_index == -1)
+        return;
+    if(context->ticking){
+        context->tick_list[tick_index] = nullptr;
+        context->tick_list_dirty = true;
+    } else {
+        context->tick_list[tick_index] = context->tick_list.back();
+        context->tick_list[tick_index]->tick_index = tick_index;
+        context->tick_list.pop_back();
+    }
+    tick_index = -1;
+}
+
+bool UIComponent::isTicking(){
+    return tick_index != -1;
+}
+
+void UIComponent::invalidate(){
+    context->redraw = true;
+    for(UIComponent* c = this; c != nullptr; c = c->parent){
+        if(c->layer != nullptr)
+            c->layer->dirty = true;
+    }
+}
+
+void UIComponent::accountStyles(MemoryReport& report){
+    report.add(MEMORY_STYLES,heapBytes(styles));
+    for(Style* s : styles)
+        s->accountMemory(report);
+}
+
+void UIComponent::accountMemory(MemoryReport& report){
+    report.addComponent(typeid(*this).name(),sizeof(UIComponent));
+    accountStyles(report);
+}
+
+// How far the styles paint outside the component's bounds, used to keep
+// shadows of culled children visible.
+float UIComponent::overdraw(){
+    float extent = 0;
+    for(Style* s : styles)
+        extent = std::max(extent,s->overdraw());
+    return extent;
+}
+
+// Ticks the components of the calling thread's current context.
+void UIComponent::tickAll(){
+    UIContext* ui = ::context;
+    ui->ticking = true;
+    for(size_t i = 0; i < ui->tick_list.size(); i++){
+        UIComponent* c = ui->tick_list[i];
+        if(c == nullptr)
+            continue;
+        UIComponent* a = c;
+        while(a != nullptr && !a->suspendsUpdates())
+            a = a->parent;
+        if(a == nullptr)
+            c->Update();
+    }
+    ui->ticking = false;
+    if(!ui->tick_list_dirty)
+        return;
+    ui->tick_list.erase(remove(ui->tick_list.begin(),ui->tick_list.end(),(UIComponent*)nullptr),ui->tick_list.end());
+    for(size_t i = 0; i < ui->tick_list.size(); i++)
+        ui->tick_list[i]->tick_index = i;
+    ui->tick_list_dirty = false;
+}
+
+// Whether this component's subtree should skip ticks, e.g. inside a
+// minimized window.
+bool UIComponent::suspendsUpdates(){
+    return false;
 }
 
 void UIComponent::addStyle(Style* style,int pos){
@@ -142,6 +760,10 @@ Rectangle UIComponent::getGlobalBounds(){
 }
 
 void UIComponent::UIDraw(){
+    if(show && layer != nullptr && context->active_layer == nullptr && context->renderer->cachesLayers()){
+        layer->draw(this);
+        return;
+    }
     if(show){
         Vector2 global_offset = getGlobalOffset();
         setScissor({global_offset.x,global_offset.y,dimension.x,dimension.y});
@@ -156,34 +778,48 @@ void UIComponent::UIDraw(){
 }
 
 Vector2 UIComponent::getGlobalOffset(){
-    if(parent == nullptr){
-        return offset;
+    Vector2 global = offset;
+    for(UIComponent* c = parent; c != nullptr; c = c->parent){
+        global.x += c->offset.x;
+        global.y += c->offset.y;
     }
-    return {offset.x + parent->getGlobalOffset().x,offset.y + parent->getGlobalOffset().y};
+    return global;
 }
 
-KeyboardListener::KeyboardListener(){}
+KeyboardListener::KeyboardListener(){
+    focus_context = context;
+}
 
 KeyboardListener::~KeyboardListener(){
-    if(focus == this)
-        focus = nullptr;
+    if(focus_context->keyboard_focus == this)
+        focus_context->keyboard_focus = nullptr;
 }
 
 void KeyboardListener::HandleKey(int key){
     if(!isFocused())
         return;
-    if(IsKeyDown(last_char))
-        KeyType(last_char);
-    if(!IsKeyDown(last_char))
-        KeyRelease(last_char);
+    if(focus_context->input->isKeyDown(focus_context->last_char))
+        KeyType(focus_context->last_char);
+    if(!focus_context->input->isKeyDown(focus_context->last_char))
+        KeyRelease(focus_context->last_char);
     if(key != 0){
         KeyPress(key);
-        last_char = key;
+        focus_context->last_char = key;
     }
 }
 
+char KeyboardListener::translateKey(int key){
+    bool shift_pressed = context->input->isKeyDown(KEY_LEFT_SHIFT) || context->input->isKeyDown(KEY_RIGHT_SHIFT);
+    char c = (char)key;
+    if(c >= 'A' && c <= 'Z' && !shift_pressed)
+        c += 32;
+    else if (shift_pressed && shift_map.find(c) != shift_map.end())
+        c = shift_map[c];
+    return c;
+}
+
 bool KeyboardListener::isFocused(){
-    return focus == this; 
+    return focus_context->keyboard_focus == this; 
 }
 
 void KeyboardListener::KeyPress(int key){
@@ -218,7 +854,268 @@ void Counter::Reset(){
     count = 0;
 }
 
-MouseListener::MouseListener(){}
+Timer::Timer(std::function<void()> callback){
+    live_count++;
+    context = ::context;
+    this->callback = callback;
+    deadline = 0;
+    interval = 0;
+    repeat = false;
+    state = TIMER_IDLE;
+    slot = -1;
+    prev = nullptr;
+    next = nullptr;
+}
+
+Timer::~Timer(){
+    stop();
+    live_count--;
+}
+
+void Timer::start(double delay,bool repeat){
+    stop();
+    this->interval = delay;
+    this->repeat = repeat;
+    deadline = context->scheduler.now + delay;
+    context->scheduler.timers.schedule(this);
+}
+
+void Timer::stop(){
+    if(state != TIMER_IDLE)
+        context->scheduler.timers.unlink(this);
+}
+
+bool Timer::active(){
+    return state != TIMER_IDLE;
+}
+
+TimerWheel::TimerWheel(double resolution){
+    this->resolution = resolution;
+    for(int i = 0; i < slot_count; i++)
+        slots[i] = nullptr;
+    current_tick = 0;
+    queued = 0;
+}
+
+void TimerWheel::schedule(Timer* t){
+    long tick = max((long)(t->deadline / resolution),current_tick);
+    t->slot = tick & (slot_count - 1);
+    t->prev = nullptr;
+    t->next = slots[t->slot];
+    if(slots[t->slot] != nullptr)
+        slots[t->slot]->prev = t;
+    slots[t->slot] = t;
+    t->state = TIMER_QUEUED;
+    queued++;
+}
+
+void TimerWheel::unlink(Timer* t){
+    if(t->state == TIMER_DUE){
+        replace(due.begin(),due.end(),t,(Timer*)nullptr);
+    } else if(t->state == TIMER_QUEUED){
+        if(t->prev != nullptr)
+            t->prev->next = t->next;
+        else
+            slots[t->slot] = t->next;
+        if(t->next != nullptr)
+            t->next->prev = t->prev;
+        queued--;
+    }
+    t->prev = nullptr;
+    t->next = nullptr;
+    t->state = TIMER_IDLE;
+}
+
+void TimerWheel::advance(double now){
+    long target = (long)(now / resolution);
+    if(target < current_tick)
+        return;
+    long steps = min(target - current_tick + 1,(long)slot_count);
+    for(long i = 0; i < steps; i++){
+        Timer* t = slots[(current_tick + i) & (slot_count - 1)];
+        while(t != nullptr){
+            Timer* next = t->next;
+            if(t->deadline <= now){
+                unlink(t);
+                t->state = TIMER_DUE;
+                due.push_back(t);
+            }
+            t = next;
+        }
+    }
+    current_tick = target + 1;
+    for(size_t i = 0; i < due.size(); i++){
+        Timer* t = due[i];
+        if(t == nullptr)
+            continue;
+        due[i] = nullptr;
+        t->state = TIMER_IDLE;
+        if(t->repeat){
+            t->deadline = max(t->deadline + t->interval,now);
+            schedule(t);
+        }
+        if(t->callback != nullptr)
+            t->callback();
+    }
+    due.clear();
+}
+
+double TimerWheel::nextDeadline(){
+    double deadline = -1;
+    if(queued == 0)
+        return deadline;
+    for(int i = 0; i < slot_count; i++){
+        for(Timer* t = slots[i]; t != nullptr; t = t->next){
+            if(deadline < 0 || t->deadline < deadline)
+                deadline = t->deadline;
+        }
+    }
+    return deadline;
+}
+
+int TimerWheel::size(){
+    return queued;
+}
+
+Animator::~Animator(){
+    for(Tween* t : tweens)
+        delete t;
+    for(Tween* t : free_tweens)
+        delete t;
+}
+
+Tween* Animator::animate(double duration,std::function<void(float)> apply,Easing easing,void* target){
+    if(target != nullptr)
+        cancel(target);
+    Tween* t;
+    if(free_tweens.empty())
+        t = new Tween{target,context->scheduler.now,duration,easing,false,std::move(apply),nullptr};
+    else {
+        t = free_tweens.back();
+        free_tweens.pop_back();
+        *t = Tween{target,context->scheduler.now,duration,easing,false,std::move(apply),nullptr};
+    }
+    tweens.push_back(t);
+    return t;
+}
+
+Tween* Animator::animate(float* value,float to,double duration,Easing easing){
+    float from = *value;
+    return animate(duration,[value,from,to](float p){
+        *value = from + (to - from) * p;
+    },easing,value);
+}
+
+Tween* Animator::animate(Color* color,Color to,double duration,Easing easing){
+    Color from = *color;
+    return animate(duration,[color,from,to](float p){
+        color->r = from.r + (to.r - from.r) * p;
+        color->g = from.g + (to.g - from.g) * p;
+        color->b = from.b + (to.b - from.b) * p;
+        color->a = from.a + (to.a - from.a) * p;
+    },easing,color);
+}
+
+void Animator::cancel(void* target){
+    for(Tween* t : tweens){
+        if(t->target == target)
+            t->finished = true;
+    }
+}
+
+void Animator::advance(double now){
+    size_t count = tweens.size();
+    for(size_t i = 0; i < count; i++){
+        Tween* t = tweens[i];
+        if(t->finished)
+            continue;
+        float p = t->duration > 0 ? min(1.0,(now - t->start) / t->duration) : 1;
+        if(t->easing == EASE_IN)
+            p = p * p;
+        else if(t->easing == EASE_OUT)
+            p = p * (2 - p);
+        else if(t->easing == EASE_IN_OUT)
+            p = p < .5f ? 2 * p * p : -1 + (4 - 2 * p) * p;
+        t->apply(p);
+        if(p >= 1){
+            t->finished = true;
+            if(t->done != nullptr)
+                t->done();
+        }
+    }
+    for(size_t i = 0; i < tweens.size(); i++){
+        if(tweens[i]->finished){
+            tweens[i]->apply = nullptr;
+            tweens[i]->done = nullptr;
+            free_tweens.push_back(tweens[i]);
+            tweens[i] = tweens.back();
+            tweens.pop_back();
+            i--;
+        }
+    }
+}
+
+bool Animator::active(){
+    return !tweens.empty();
+}
+
+Scheduler::Scheduler(){
+    now = 0;
+}
+
+void Scheduler::advance(double now){
+    this->now = now;
+    timers.advance(now);
+    animator.advance(now);
+}
+
+double Scheduler::nextDeadline(){
+    if(animator.active())
+        return now;
+    return timers.nextDeadline();
+}
+
+MouseListener::MouseListener(){
+    listener_context = context;
+    listener_parent = nullptr;
+    hovered = false;
+}
+
+MouseListener::~MouseListener(){
+    if(hovered){
+        vector<MouseListener*>& path = listener_context->hover_path;
+        path.erase(remove(path.begin(),path.end(),this),path.end());
+        listener_context->hover_dirty = true;
+    }
+}
+
+void MouseListener::invalidateHover(){
+    context->hover_dirty = true;
+}
+
+void MouseListener::updateHover(MouseListener* root,Vector2 mouse_pos){
+    if(!context->hover_dirty && mouse_pos.x == context->last_hover_pos.x && mouse_pos.y == context->last_hover_pos.y)
+        return;
+    context->hover_dirty = false;
+    context->last_hover_pos = mouse_pos;
+    context->last_hover_path.swap(context->hover_path);
+    context->hover_path.clear();
+    root->onHover(mouse_pos);
+    for(int i = context->last_hover_path.size() - 1; i >= 0; i--){
+        MouseListener* l = context->last_hover_path[i];
+        if(find(context->hover_path.begin(),context->hover_path.end(),l) == context->hover_path.end()){
+            l->hovered = false;
+            l->onMouseLeave();
+        }
+    }
+    for(MouseListener* l : context->hover_path){
+        if(!l->hovered){
+            l->hovered = true;
+            l->onMouseEnter();
+        }
+    }
+    context->last_hover_path.clear();
+}
 
 
 void MouseListener::init(){
@@ -227,7 +1124,6 @@ void MouseListener::init(){
         cout << "Error: Mouse listener parent is not a UI component" << endl;
         return;
     }
-    UIComponent* l = listener_parent;
 }
 
 void MouseListener::UpdateClip(){
@@ -250,8 +1146,11 @@ bool MouseListener::Hover(Vector2 mousePos){
     Vector2 dim = listener_parent->dimension;
     Rectangle clip_rect = Rectangle{off.x,off.y,dim.x,dim.y};
     if(CheckCollisionPointRec(mousePos,clip_rect)){
+        size_t depth = context->hover_path.size();
+        context->hover_path.push_back(this);
         if(onHover(mousePos))
             return true;
+        context->hover_path.resize(depth);
     }
     return false;
 }
@@ -264,6 +1163,10 @@ bool MouseListener::onHover(Vector2 mouse_pos){
     return true;
 }
 
+void MouseListener::onMouseEnter(){}
+
+void MouseListener::onMouseLeave(){}
+
 bool MouseListener::operator<(const MouseListener& other) const{
     return listener_parent < other.listener_parent;
 }
@@ -278,26 +1181,46 @@ Container::Container(Vector2 offset,Vector2 dimension,Layout layout,Color backgr
 
 Container::~Container(){
     for(UIComponent* c : components)
-        delete c;
+        release(c);
 }
 
 void Container::clear(){
     for(UIComponent* c : components)
-        delete c;
+        release(c);
     components.clear();
     listeners.clear();
+    invalidateHover();
+    invalidate();
 }
 
 void Container::Draw(){
-    priority_queue<UIComponent*,vector<UIComponent*>,CompareUIComponents> max_heap;
-    for(auto c : components){
-        max_heap.push(c);
+    draw_order.assign(components.begin(),components.end());
+    sortByZ(draw_order,[](UIComponent* c){ return c->z_index; });
+    if(context->scissor_stack.empty()){
+        for(UIComponent* c : draw_order)
+            c->UIDraw();
+        return;
     }
-
-    while(!max_heap.empty()){
-        UIComponent* c = max_heap.top();
-        max_heap.pop();
-        c->UIDraw();
+    size_t n = draw_order.size();
+    rects.resize(n);
+    for(size_t i = 0; i < n; i++){
+        UIComponent* c = draw_order[i];
+        rects.x[i] = c->offset.x;
+        rects.y[i] = c->offset.y;
+        rects.w[i] = c->dimension.x;
+        rects.h[i] = c->dimension.y;
+    }
+    globalRectsKernel(rects.x.data(),rects.y.data(),n,getGlobalOffset(),rects.x.data(),rects.y.data());
+    Rectangle clip = context->scissor_stack.top();
+    clipRectsKernel(rects.x.data(),rects.y.data(),rects.w.data(),rects.h.data(),n,clip,rects.mask.data());
+    for(size_t i = 0; i < n; i++){
+        if(!rects.mask[i]){
+            // A culled child may still cast a shadow into the clip.
+            float extent = draw_order[i]->overdraw();
+            if(extent <= 0 || !CheckCollisionRecs({rects.x[i]-extent,rects.y[i]-extent,rects.w[i]+2*extent,rects.h[i]+2*extent},clip))
+                continue;
+        }
+        draw_order[i]->UIDraw();
     }
 }
 
@@ -307,35 +1230,52 @@ void Container::Update(){
     }
 }
 
-bool Container::removeComponent(int id){
-    for(int i = 0; i < components.size(); i++){
+UIComponent* Container::detachComponent(int id){
+    for(size_t i = 0; i < components.size(); i++){
         UIComponent* c = components[i];
         if(c->id == id){
-            components.erase(remove(components.begin(),components.end(),c),components.end());
+            components.erase(components.begin() + i);
             removeListener(id);
-            delete c;
-            return true;
+            c->parent = nullptr;
+            invalidate();
+            return c;
         }
     }
-    return false;
+    return nullptr;
+}
+
+bool Container::removeComponent(int id){
+    UIComponent* c = detachComponent(id);
+    if(c == nullptr)
+        return false;
+    release(c);
+    return true;
 }
 
 bool Container::removeListener(int id){
-    for(int i = 0; i < listeners.size(); i++){
+    for(size_t i = 0; i < listeners.size(); i++){
         MouseListener* l = listeners[i];
         UIComponent* c = dynamic_cast<UIComponent*>(l);
         if(c == nullptr)
             cout << "Error: Mouse listener is not a UI component" << endl;
         if(c->id == id){
             listeners.erase(remove(listeners.begin(),listeners.end(),l),listeners.end());
+            invalidateHover();
             return true;
         }
     }
     return false;
 }
 
+// Adds component without positioning it; the caller relayouts afterwards.
+// Containers that place children only as they are added keep doing so.
+void Container::appendComponent(UIComponent* c){
+    addComponent(c);
+}
+
 void Container::addListener(MouseListener* l){
     listeners.push_back(l);
+    invalidateHover();
 }
 
 void Container::addBoth(UIComponent* c){
@@ -354,31 +1294,59 @@ bool Container::setBounds(Vector2 offset,Vector2 dimension){
     return true;
 }
 
+void Container::accountMemory(MemoryReport& report){
+    report.addComponent(dynamic_cast<StaticContainer*>(this) != nullptr ? "StaticContainer" : "DynamicContainer",sizeof(Container));
+    accountStyles(report);
+    report.add(MEMORY_COMPONENTS,heapBytes(components) + heapBytes(listeners));
+    report.add(MEMORY_BUFFERS,heapBytes(draw_order) + heapBytes(hit_order) + rects.heapBytes());
+    for(UIComponent* c : components)
+        c->accountMemory(report);
+}
+
+void Container::sortHitOrder(){
+    hit_order.assign(listeners.begin(),listeners.end());
+    sortByZ(hit_order,[](MouseListener* l){ return l->listener_parent->z_index; });
+}
+
+// Sorts the listeners and marks in rects.mask the ones whose bounds contain
+// mouse_pos. Listeners that are not direct children contribute their offset
+// relative to this container so one globalRectsKernel pass covers them all.
+size_t Container::hitTest(Vector2 mouse_pos){
+    sortHitOrder();
+    size_t n = hit_order.size();
+    rects.resize(n);
+    Vector2 origin = getGlobalOffset();
+    for(size_t i = 0; i < n; i++){
+        UIComponent* c = hit_order[i]->listener_parent;
+        Vector2 off = c->offset;
+        if(c->parent != this){
+            off = c->getGlobalOffset();
+            off = {off.x - origin.x,off.y - origin.y};
+        }
+        rects.x[i] = off.x;
+        rects.y[i] = off.y;
+        rects.w[i] = c->dimension.x;
+        rects.h[i] = c->dimension.y;
+    }
+    globalRectsKernel(rects.x.data(),rects.y.data(),n,origin,rects.x.data(),rects.y.data());
+    return pointInRectsKernel(rects.x.data(),rects.y.data(),rects.w.data(),rects.h.data(),n,mouse_pos,rects.mask.data());
+}
+
 bool Container::onClick(Vector2 mousePos,MouseButton button){
-    priority_queue<MouseListener*,vector<MouseListener*>,CompareMouseListeners> min_heap; 
-    for(auto l : listeners)
-        min_heap.push(l);
-
-    while(!min_heap.empty()){
-        MouseListener* l = min_heap.top();
-        min_heap.pop();    
-        if(l->Click(mousePos,button))
+    if(hitTest(mousePos) == 0)
+        return false;
+    for(size_t i = hit_order.size(); i-- > 0;)
+        if(rects.mask[i] && hit_order[i]->onClick(mousePos,button))
             return true;
-    }
     return false;
 }
 
 bool Container::onHover(Vector2 mousePos){
-    priority_queue<MouseListener*,vector<MouseListener*>,CompareMouseListeners> min_heap;
-    for(auto l : listeners)
-        min_heap.push(l);
-
-    while(!min_heap.empty()){
-        MouseListener* l = min_heap.top();
-        min_heap.pop();    
-        if(l->Hover(mousePos))
+    if(hitTest(mousePos) == 0)
+        return false;
+    for(size_t i = hit_order.size(); i-- > 0;)
+        if(rects.mask[i] && hit_order[i]->Hover(mousePos))
             return true;
-    }
     return false;
 }
 
@@ -412,11 +1380,32 @@ void StaticContainer::addComponent(UIComponent* c,bool fill){
         cout << "Error: Component could not be resized" << endl;
     c->parent = this;
     components.push_back(c);
+    invalidate();
 }
 
-bool StaticContainer::setBounds(Vector2 off,Vector2 dim){
-    double max_x = components.size() > 0 ? components[components.size()-1]->offset.x + components[components.size()-1]->dimension.x : 0;
-    double max_y = components.size() > 0 ? components[components.size()-1]->offset.y + components[components.size()-1]->dimension.y : 0;
+// Space the children need along the layout axis; a FREE container can
+// shrink to nothing.
+Vector2 StaticContainer::contentExtent(){
+    if(components.empty() || layout == FREE)
+        return {0,0};
+    UIComponent* last = components[components.size()-1];
+    if(layout == HORIZONTAL)
+        return {last->offset.x + last->dimension.x,0};
+    return {0,last->offset.y + last->dimension.y};
+}
+
+void StaticContainer::appendComponent(UIComponent* c){
+    if(layout == FREE){
+        addComponent(c);
+        return;
+    }
+    c->parent = this;
+    components.push_back(c);
+}
+
+bool StaticContainer::setBounds(Vector2 off,Vector2 dim){
+    double max_x = components.size() > 0 ? components[components.size()-1]->offset.x + components[components.size()-1]->dimension.x : 0;
+    double max_y = components.size() > 0 ? components[components.size()-1]->offset.y + components[components.size()-1]->dimension.y : 0;
     if(layout == HORIZONTAL && dim.x < max_x)
         return false;
     if(layout == VERTICAL && dim.y < max_y)
@@ -426,6 +1415,20 @@ bool StaticContainer::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void StaticContainer::relayout(){
+    float pos = 0;
+    for(UIComponent* c : components){
+        if(layout == HORIZONTAL){
+            c->setBounds({pos,0},{c->dimension.x,dimension.y});
+            pos += c->dimension.x;
+        } else if(layout == VERTICAL){
+            c->setBounds({0,pos},{dimension.x,c->dimension.y});
+            pos += c->dimension.y;
+        }
+    }
+    invalidate();
+}
+
 DynamicContainer::DynamicContainer(Vector2 offset,Layout layout,Color background_color):
 Container(offset,{0,0},layout,background_color){}
 
@@ -453,6 +1456,7 @@ void DynamicContainer::addComponent(UIComponent* c,bool fill){
     c->parent = this;
     components.push_back(c);
     dimension = new_container_dim;
+    invalidate();
 }
 
 bool DynamicContainer::setBounds(Vector2 off,Vector2 dim=Vector2{0,0}){
@@ -472,19 +1476,26 @@ Text::Text(Vector2 offset,string text,int font_size,Allignment a,Color text_colo
     dimension = calculateDimension();
 }
 
+Text::Text(Vector2 offset,Vector2 dimension,string text,int font_size,Allignment a,Color text_color) : UIComponent(nullptr,offset,dimension){
+    this->str = text;
+    this->text_color = text_color;
+    this->size = font_size;
+    this->a = a;
+}
+
 void Text::Draw(){
     Vector2 offset = getGlobalOffset();
     Vector2 text_dim = calculateDimension();
     Vector2 dim = dimension;
     if(dim.x == text_dim.x && dim.y == text_dim.y){
-        DrawTextEx(font,str.c_str(),offset,size,2,text_color);
+        context->renderer->drawText(str.c_str(),offset,size,2,text_color);
         return;
     }
     if(a == MIDDLE)
         offset = {offset.x + (dim.x - text_dim.x) / 2,offset.y + (dim.y - text_dim.y) / 2};
     if(a == RIGHT)
         offset = {offset.x + (dim.x - text_dim.x),offset.y + (dim.y - text_dim.y)};
-    DrawTextEx(font,str.c_str(),offset,size,2,text_color);
+    context->renderer->drawText(str.c_str(),offset,size,2,text_color);
 }
 
 void Text::Update(){
@@ -500,14 +1511,29 @@ bool Text::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void Text::accountMemory(MemoryReport& report){
+    report.addComponent("Text",sizeof(Text));
+    accountStyles(report);
+    report.add(MEMORY_STRINGS,heapBytes(str));
+}
+
 Vector2 Text::calculateDimension(){
-    Vector2 dim = MeasureTextEx(font,str.c_str(),size,2);
+    Vector2 dim = MeasureTextEx(context->font,str.c_str(),size,2);
     return dim;
 }
 
-void Text::setText(string text){
-    this->str = text;
+void Text::setText(const string& text){
+    if(text == str)
+        return;
+    str.assign(text);
     dimension = calculateDimension();
+    invalidate();
+}
+
+void Text::bind(Observable<string>& cell){
+    cell.subscribe(binding,[this](const string& val){
+        setText(val);
+    });
 }
 
 Box::Box(Rectangle rec) 
@@ -524,10 +1550,20 @@ bool Box::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void Box::accountMemory(MemoryReport& report){
+    report.addComponent("Box",sizeof(Box));
+    accountStyles(report);
+}
+
 UIImage::UIImage(Texture texture){
     this->texture = texture;
 }
 
+void UIImage::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(UIImage));
+    report.add(MEMORY_TEXTURES,GetPixelDataSize(texture.width,texture.height,texture.format));
+}
+
 void UIImage::DrawBelow(UIComponent* c){
     Vector2 offset = c->getGlobalOffset();
     Vector2 dim = c->dimension;
@@ -545,8 +1581,22 @@ Button::Button(UIComponent* c,std::function<void(Vector2,MouseButton)> click_cal
     init();
 }
 
+// Takes a background owned by the caller, so a fixed panel can keep the
+// button, its label and its style inline.
+Button::Button(UIComponent* c,Background* background,std::function<void(Vector2,MouseButton)> click_callback)
+:UIComponent(nullptr,c->offset,c->dimension),MouseListener(){
+    this->component = c;
+    c->parent = this;
+    this->click_callback = click_callback;
+    this->background = background;
+    addStyle(background);
+    default_color = background->color;
+    init();
+}
+
 Button::~Button(){
-    delete component;
+    context->scheduler.animator.cancel(&background->color);
+    release(component);
 }
 
 void Button::Draw(){
@@ -555,7 +1605,6 @@ void Button::Draw(){
 
 void Button::Update(){
     component->Update();
-    background->color = default_color;
 }
 
 bool Button::setBounds(Vector2 off,Vector2 dim){
@@ -569,44 +1618,178 @@ bool Button::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void Button::accountMemory(MemoryReport& report){
+    report.addComponent("Button",sizeof(Button) - sizeof(click_callback));
+    report.add(MEMORY_CALLBACKS,sizeof(click_callback));
+    accountStyles(report);
+    component->accountMemory(report);
+}
+
+float Button::overdraw(){
+    return std::max(UIComponent::overdraw(),component->overdraw());
+}
+
 void Button::addStyle(Style* style,int pos){
     component->addStyle(style,pos);
 }
 
 bool Button::onClick(Vector2 mousePos,MouseButton button){
-    cout << "Clicked" << endl;
     click_callback(mousePos,button);
     return true;
 }
 
-bool Button::onHover(Vector2 mousePos){
-    background->color = hover_color;
-    return true;
+void Button::fadeTo(Color to,double duration){
+    Color from = background->color;
+    context->scheduler.animator.animate(duration,[this,from,to](float p){
+        background->color = Color{(unsigned char)(from.r + (to.r - from.r) * p),(unsigned char)(from.g + (to.g - from.g) * p),
+                                  (unsigned char)(from.b + (to.b - from.b) * p),(unsigned char)(from.a + (to.a - from.a) * p)};
+        invalidate();
+    },EASE_OUT,&background->color);
+}
+
+void Button::onMouseEnter(){
+    fadeTo(hover_color,.08);
+}
+
+void Button::onMouseLeave(){
+    fadeTo(default_color,.15);
+}
+
+Style::Style(){
+    static_storage = false;
+    live_count++;
+}
+
+void Style::release(Style* s){
+    if(!s->static_storage)
+        delete s;
+}
+
+Style::~Style(){
+    live_count--;
+}
+
+void Style::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Style));
 }
 
 void Style::DrawAbove(UIComponent* c){}
 
 void Style::DrawBelow(UIComponent* c){}
 
-void Style::OnAdd(UIComponent* c){}   
+void Style::OnAdd(UIComponent* c){}
+
+float Style::overdraw(){
+    return 0;
+}   
+
+Layer::Layer(){
+    context = ::context;
+    renderer = nullptr;
+    loaded = false;
+    dirty = true;
+}
+
+Layer::~Layer(){
+    evict();
+}
+
+void Layer::OnAdd(UIComponent* c){
+    c->layer = this;
+}
+
+size_t Layer::bytes(){
+    return loaded ? (size_t)texture.texture.width * texture.texture.height * 4 : 0;
+}
+
+void Layer::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Layer));
+    report.add(MEMORY_TEXTURES,bytes());
+}
+
+void Layer::evict(){
+    if(!loaded)
+        return;
+    context->layer_used -= bytes();
+    renderer->unloadRenderTarget(texture);
+    context->layer_lru.erase(lru_pos);
+    loaded = false;
+    dirty = true;
+}
+
+void Layer::draw(UIComponent* c){
+    Vector2 global_offset = c->getGlobalOffset();
+    int width = (int)ceil(c->dimension.x);
+    int height = (int)ceil(c->dimension.y);
+    if(width <= 0 || height <= 0)
+        return;
+    if(loaded && (renderer != context->renderer || texture.texture.width != width || texture.texture.height != height))
+        evict();
+    if(!loaded){
+        while(context->layer_used + (size_t)width * height * 4 > budget && !context->layer_lru.empty())
+            context->layer_lru.back()->evict();
+        texture = context->renderer->loadRenderTarget(width,height);
+        if(texture.id == 0){
+            // The renderer has no render targets, so draw uncached.
+            context->active_layer = this;
+            c->UIDraw();
+            context->active_layer = nullptr;
+            return;
+        }
+        renderer = context->renderer;
+        loaded = true;
+        context->layer_used += bytes();
+        context->layer_lru.push_front(this);
+        lru_pos = context->layer_lru.begin();
+    } else
+        context->layer_lru.splice(context->layer_lru.begin(),context->layer_lru,lru_pos);
+    if(dirty){
+        stack<Rectangle> saved_scissor;
+        saved_scissor.swap(context->scissor_stack);
+        if(!saved_scissor.empty())
+            renderer->endScissor();
+        Vector2 saved_offset = c->offset;
+        c->offset = {saved_offset.x - global_offset.x,saved_offset.y - global_offset.y};
+        renderer->beginRenderTarget(texture,BLANK);
+        context->active_layer = this;
+        c->UIDraw();
+        context->active_layer = nullptr;
+        renderer->endRenderTarget();
+        c->offset = saved_offset;
+        context->scissor_stack.swap(saved_scissor);
+        if(!context->scissor_stack.empty())
+            renderer->beginScissor(context->scissor_stack.top());
+        dirty = false;
+    }
+    context->renderer->drawTexture(texture.texture,Rectangle{0,0,(float)width,-(float)height},Rectangle{global_offset.x,global_offset.y,(float)width,(float)height},WHITE);
+}
 
-Border::Border(int margin,Color margin_col){
+Border::Border(int margin,Color margin_col,int radius){
     this->margin = margin;
+    this->radius = radius;
     this->margin_color = margin_col;
     U = true; D = true; L = true; R = true;
 }
 
+void Border::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Border));
+}
+
 void Border::DrawAbove(UIComponent* c){
     Vector2 global_offset = c->getGlobalOffset();
     Vector2 dimension = c->dimension;
+    if(radius > 0){
+        context->nine_slices.draw(Rectangle{global_offset.x,global_offset.y,dimension.x,dimension.y},radius,margin,0,margin_color);
+        return;
+    }
     if(U)
-        DrawRectangle(global_offset.x,global_offset.y,dimension.x,margin,margin_color);
+        context->renderer->drawRectangle(Rectangle{global_offset.x,global_offset.y,dimension.x,(float)margin},margin_color);
     if(D)
-        DrawRectangle(global_offset.x,global_offset.y + dimension.y-margin,dimension.x,margin,margin_color);
+        context->renderer->drawRectangle(Rectangle{global_offset.x,global_offset.y + dimension.y-margin,dimension.x,(float)margin},margin_color);
     if(L)
-        DrawRectangle(global_offset.x,global_offset.y,margin,dimension.y,margin_color);
+        context->renderer->drawRectangle(Rectangle{global_offset.x,global_offset.y,(float)margin,dimension.y},margin_color);
     if(R)
-        DrawRectangle(global_offset.x+dimension.x-margin,global_offset.y,margin,dimension.y,margin_color);
+        context->renderer->drawRectangle(Rectangle{global_offset.x+dimension.x-margin,global_offset.y,(float)margin,dimension.y},margin_color);
 }
 
 void Border::OnAdd(UIComponent* c){
@@ -614,14 +1797,45 @@ void Border::OnAdd(UIComponent* c){
     c->dimension = {c->dimension.x + 2*margin,c->dimension.y + 2*margin};
 }
 
-Background::Background(Color background_color){
+Background::Background(Color background_color,int radius){
     this->color = background_color;
+    this->radius = radius;
+    shadow_blur = 0;
+    shadow_offset = {0,0};
+    shadow_color = BLANK;
+}
+
+void Background::setShadow(int blur,Vector2 offset,Color color){
+    shadow_blur = blur;
+    shadow_offset = offset;
+    shadow_color = color;
+}
+
+float Background::overdraw(){
+    if(shadow_color.a == 0)
+        return 0;
+    return shadow_blur + std::max(fabsf(shadow_offset.x),fabsf(shadow_offset.y));
+}
+
+void Background::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Background));
 }
 
 void Background::DrawBelow(UIComponent* c){
     Vector2 global_offset = c->getGlobalOffset();
     Vector2 dimension = c->dimension;
-    DrawRectangle(global_offset.x,global_offset.y,dimension.x,dimension.y,color);
+    Rectangle r = {global_offset.x,global_offset.y,dimension.x,dimension.y};
+    if(shadow_color.a > 0){
+        // The shadow falls outside the component, so draw it under the parent's clip.
+        Rectangle clip = context->scissor_stack.top();
+        endScissor();
+        context->nine_slices.draw(Rectangle{r.x + shadow_offset.x,r.y + shadow_offset.y,r.width,r.height},radius,0,shadow_blur,shadow_color);
+        setScissor(clip);
+    }
+    if(radius > 0)
+        context->nine_slices.draw(r,radius,0,0,color);
+    else
+        context->renderer->drawRectangle(r,color);
 }
 
 Clip::Clip(Rectangle r,bool relative){
@@ -629,6 +1843,10 @@ Clip::Clip(Rectangle r,bool relative){
     this->relative = relative;
 }
 
+void Clip::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Clip));
+}
+
 void Clip::DrawBelow(UIComponent* c){
     Vector2 c_offset = relative ? c->getGlobalOffset() : Vector2{0,0};
     Rectangle r = {c_offset.x + view.x,c_offset.y + view.y,view.width,view.height};
@@ -644,6 +1862,10 @@ Scroll::Scroll(Rectangle view,Vector2 offset){
     this->offset = offset;
 }
 
+void Scroll::accountMemory(MemoryReport& report){
+    report.add(MEMORY_STYLES,sizeof(Scroll));
+}
+
 void Scroll::DrawBelow(UIComponent* c){
     setScissor(view);
 }
@@ -652,11 +1874,13 @@ void Scroll::DrawAbove(UIComponent* c){
     endScissor();
 }
 
-Draggable::Draggable(){}
+Draggable::Draggable(){
+    drag_context = context;
+}
 
 Draggable::~Draggable(){
-    if(focus == this)
-        focus = nullptr;
+    if(drag_context->drag_focus == this)
+        drag_context->drag_focus = nullptr;
 }
 
 TitleBar::TitleBar(Vector2 offset, Vector2 dimension, string title)
@@ -674,23 +1898,22 @@ TitleBar::~TitleBar(){
 
 void TitleBar::addComponents(){
     container = new StaticContainer(Vector2{0,0},dimension,HORIZONTAL); 
-    Text* title_name = new Text(Vector2{0,0},title,20,LEFT,BLACK);
-    Button* close_window = new Button(new Text(Vector2{0,0},"X",20,MIDDLE,BLACK),[this](Vector2 mousePos,MouseButton button){
+    title_name = new Text(Vector2{0,0},title,20,LEFT,BLACK);
+    close_button = new Button(new Text(Vector2{0,0},"X",20,MIDDLE,BLACK),[this](Vector2,MouseButton){
         Window* window_parent = dynamic_cast<Window*>(this->parent->parent);
         //                                          Button -> Container -> TitleBar -> Container -> Window
         if(window_parent == nullptr){
             cout << "Error: Not a window" << endl;
             return;
         }
-        cout << "Killing" << endl;
         window_parent->Kill();
     },RED);
-    float spacer_width = dimension.x - title_name->dimension.x - close_window->dimension.x;
-    Box* spacer = new Box({0,0,spacer_width,0});
+    float spacer_width = max(0.0f,dimension.x - title_name->dimension.x - close_button->dimension.x);
+    spacer = new Box({0,0,spacer_width,0});
     container->addComponent(title_name);
     container->addComponent(spacer);
-    container->addComponent(close_window);
-    container->addListener(close_window);
+    container->addComponent(close_button);
+    container->addListener(close_button);
     container->parent = this;
 }
 
@@ -704,15 +1927,24 @@ void TitleBar::Update(){
 
 bool TitleBar::setBounds(Vector2 off,Vector2 dim){
     this->offset = off;
-    this->dimension = dim;
     if(dim.x == dimension.x && dim.y == dimension.y)
         return true;
-    addComponents();
+    this->dimension = dim;
+    spacer->dimension.x = max(0.0f,dim.x - title_name->dimension.x - close_button->dimension.x);
+    container->dimension = dim;
+    container->relayout();
     return true;
 }
 
+void TitleBar::accountMemory(MemoryReport& report){
+    report.addComponent("TitleBar",sizeof(TitleBar));
+    accountStyles(report);
+    report.add(MEMORY_STRINGS,heapBytes(title));
+    container->accountMemory(report);
+}
+
 bool TitleBar::onClick(Vector2 mousePos,MouseButton button){
-    Draggable::focus = this;
+    context->drag_focus = this;
     start_drag = parent->parent->offset;
     return container->onClick(mousePos,button);
 }
@@ -733,24 +1965,29 @@ void TitleBar::onDrag(Vector2 startPos,Vector2 delta,MouseButton button){
         return;
     }
     window_parent->offset = {start_drag.x + delta.x,start_drag.y + delta.y};
+    if(window_parent->parent != nullptr)
+        window_parent->parent->invalidate();
 }
 
 Window::Window(Vector2 offset, Vector2 dimension, string title)
-:UIComponent(nullptr,offset,dimension),MouseListener(){
+:UIComponent(nullptr,offset,dimension),MouseListener(),Draggable(){
     border = new Border(2,UIComponent::secondary_color);
     addStyle(border);
-    addComponents();
+    opaque = true;
+    minimized = false;
+    occluded = false;
+    resize_edges = RESIZE_NONE;
+    addComponents(title);
     init();
-    cout << dimension.x << ":" << dimension.y << endl;
 }
 
 Window::~Window(){
     delete root_container;
 }
 
-void Window::addComponents(){
+void Window::addComponents(string title){
     root_container = new StaticContainer({0,0},dimension,VERTICAL,RAYWHITE); 
-    title_bar = new TitleBar({0,0},{dimension.x,(float)TitleBar::title_bar_height},"Window");
+    title_bar = new TitleBar({0,0},{dimension.x,(float)TitleBar::title_bar_height},title);
     content = new StaticContainer({0,(float)TitleBar::title_bar_height},{dimension.x,dimension.y - TitleBar::title_bar_height},FREE);
     root_container->addComponent(title_bar);
     root_container->addListener(title_bar);
@@ -777,25 +2014,109 @@ void Window::Update(){
     root_container->Update();
 }
 
+// The smallest size whose content area still fits the laid out children,
+// so shrinking never leaves content->setBounds failing.
+Vector2 Window::minimumSize(){
+    Vector2 fit = content->contentExtent();
+    float title_height = title_bar->dimension.y;
+    return {max(min_size.x,fit.x),max(min_size.y,title_height + fit.y)};
+}
+
 bool Window::setBounds(Vector2 off,Vector2 dim){
+    float title_height = title_bar->dimension.y;
+    bool resized = dim.x != dimension.x || dim.y != dimension.y;
+    Vector2 min_dim = minimumSize();
+    if(resized && (dim.x < min_dim.x || dim.y < min_dim.y))
+        return false;
     this->offset = off;
-    this->dimension = dim;
-    if(dim.x == dimension.x && dim.y == dimension.y)
+    if(parent != nullptr)
+        parent->invalidate();
+    if(!resized)
         return true;
-    addComponents();
+    this->dimension = dim;
+    title_bar->setBounds({0,0},{dim.x,title_height});
+    content->setBounds({0,title_height},{dim.x,dim.y - title_height});
+    if(content->layout != FREE)
+        content->relayout();
+    root_container->setBounds({0,0},dim);
+    invalidate();
+    invalidateHover();
     return true;
 }
 
+bool Window::suspendsUpdates(){
+    if(minimized)
+        return true;
+    if(!occluded)
+        return false;
+    WindowManager* manager = dynamic_cast<WindowManager*>(parent);
+    return manager != nullptr && manager->cull_updates;
+}
+
+int Window::edgesAt(Vector2 mouse_pos){
+    Rectangle r = getGlobalBounds();
+    int edges = RESIZE_NONE;
+    if(mouse_pos.x < r.x + resize_margin)
+        edges |= RESIZE_LEFT;
+    else if(mouse_pos.x >= r.x + r.width - resize_margin)
+        edges |= RESIZE_RIGHT;
+    if(mouse_pos.y < r.y + resize_margin)
+        edges |= RESIZE_TOP;
+    else if(mouse_pos.y >= r.y + r.height - resize_margin)
+        edges |= RESIZE_BOTTOM;
+    // Over the title bar the close button and the drag area win; only the
+    // outer corners still resize there.
+    if(edges != RESIZE_NONE && CheckCollisionPointRec(mouse_pos,title_bar->getGlobalBounds())){
+        if(CheckCollisionPointRec(mouse_pos,title_bar->close_button->getGlobalBounds()))
+            return RESIZE_NONE;
+        if(!(edges & RESIZE_TOP) || !(edges & (RESIZE_LEFT | RESIZE_RIGHT)))
+            return RESIZE_NONE;
+    }
+    return edges;
+}
+
+void Window::onDrag(Vector2,Vector2 delta,MouseButton button){
+    if(button != MOUSE_LEFT_BUTTON || resize_edges == RESIZE_NONE)
+        return;
+    Rectangle r = start_bounds;
+    Vector2 min_dim = minimumSize();
+    if(resize_edges & RESIZE_LEFT){
+        float width = max(min_dim.x,r.width - delta.x);
+        r.x += r.width - width;
+        r.width = width;
+    } else if(resize_edges & RESIZE_RIGHT)
+        r.width = max(min_dim.x,r.width + delta.x);
+    if(resize_edges & RESIZE_TOP){
+        float height = max(min_dim.y,r.height - delta.y);
+        r.y += r.height - height;
+        r.height = height;
+    } else if(resize_edges & RESIZE_BOTTOM)
+        r.height = max(min_dim.y,r.height + delta.y);
+    setBounds({r.x,r.y},{r.width,r.height});
+}
+
+void Window::accountMemory(MemoryReport& report){
+    report.addComponent("Window",sizeof(Window));
+    accountStyles(report);
+    root_container->accountMemory(report);
+}
+
 void Window::Kill(){
     Container* parent = dynamic_cast<Container*>(this->parent);
     if(parent == nullptr){
         cout << "Error: Window parent is not a container" << endl;
         return;
     }
-    parent->removeComponent(id);
+    context->mutations.remove(parent,id);
 }
 
 bool Window::onClick(Vector2 mousePos,MouseButton button){
+    resize_edges = button == MOUSE_LEFT_BUTTON ? edgesAt(mousePos) : RESIZE_NONE;
+    if(resize_edges != RESIZE_NONE){
+        start_bounds = Rectangle{offset.x,offset.y,dimension.x,dimension.y};
+        context->drag_focus = this;
+        return true;
+    }
     return root_container->Click(mousePos,button);
 }
 
@@ -812,18 +2133,187 @@ void Window::addListener(MouseListener* l){
     content->addListener(l);
 }
 
+WindowManager::WindowManager(Vector2 offset,Vector2 dimension)
+:Container(offset,dimension,FREE,UIComponent::default_background_color){
+    cull_updates = false;
+    culled = 0;
+}
+
+void WindowManager::addComponent(UIComponent* c,bool){
+    Window* window = dynamic_cast<Window*>(c);
+    if(window == nullptr){
+        cout << "Error: Window manager only holds windows" << endl;
+        return;
+    }
+    if(window->opaque){
+        // A window re-added after detachComponent keeps its background.
+        bool has_background = false;
+        for(Style* s : window->styles)
+            has_background |= dynamic_cast<Background*>(s) != nullptr;
+        if(!has_background)
+            window->addStyle(new Background(UIComponent::default_background_color),0);
+    }
+    window->parent = this;
+    components.push_back(window);
+    listeners.push_back(window);
+    z_order.push_back(window);
+    window->z_pos = prev(z_order.end());
+    invalidateHover();
+    invalidate();
+}
+
+UIComponent* WindowManager::detachComponent(int id){
+    for(UIComponent* c : components){
+        if(c->id == id){
+            z_order.erase(static_cast<Window*>(c)->z_pos);
+            break;
+        }
+    }
+    return Container::detachComponent(id);
+}
+
+void WindowManager::clear(){
+    z_order.clear();
+    Container::clear();
+}
+
+bool WindowManager::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    return true;
+}
+
+void WindowManager::accountMemory(MemoryReport& report){
+    report.addComponent("WindowManager",sizeof(WindowManager));
+    accountStyles(report);
+    report.add(MEMORY_COMPONENTS,heapBytes(components) + heapBytes(listeners) + z_order.size() * 3 * sizeof(void*));
+    report.add(MEMORY_BUFFERS,heapBytes(covers) + heapBytes(pieces) + heapBytes(draw_list) + heapBytes(hit_order) + rects.heapBytes());
+    for(UIComponent* c : components)
+        c->accountMemory(report);
+}
+
+void WindowManager::raise(Window* window){
+    window->minimized = false;
+    window->show = true;
+    z_order.splice(z_order.end(),z_order,window->z_pos);
+    invalidateHover();
+    invalidate();
+}
+
+void WindowManager::minimize(Window* window){
+    window->minimized = true;
+    window->show = false;
+    invalidateHover();
+    invalidate();
+}
+
+void WindowManager::restore(Window* window){
+    raise(window);
+}
+
+Window* WindowManager::top(){
+    for(auto it = z_order.rbegin(); it != z_order.rend(); it++)
+        if(!(*it)->minimized)
+            return *it;
+    return nullptr;
+}
+
+bool WindowManager::covered(Rectangle r){
+    pieces.clear();
+    pieces.push_back(r);
+    for(Rectangle& cover : covers){
+        size_t n = pieces.size();
+        for(size_t i = 0; i < n; i++){
+            Rectangle p = pieces[i];
+            float x0 = max(p.x,cover.x);
+            float y0 = max(p.y,cover.y);
+            float x1 = min(p.x + p.width,cover.x + cover.width);
+            float y1 = min(p.y + p.height,cover.y + cover.height);
+            if(x0 >= x1 || y0 >= y1){
+                pieces.push_back(p);
+                continue;
+            }
+            if(p.y < y0)
+                pieces.push_back({p.x,p.y,p.width,y0 - p.y});
+            if(y1 < p.y + p.height)
+                pieces.push_back({p.x,y1,p.width,p.y + p.height - y1});
+            if(p.x < x0)
+                pieces.push_back({p.x,y0,x0 - p.x,y1 - y0});
+            if(x1 < p.x + p.width)
+                pieces.push_back({x1,y0,p.x + p.width - x1,y1 - y0});
+        }
+        pieces.erase(pieces.begin(),pieces.begin() + n);
+        if(pieces.empty())
+            return true;
+    }
+    return false;
+}
+
+void WindowManager::Draw(){
+    covers.clear();
+    draw_list.clear();
+    culled = 0;
+    for(auto it = z_order.rbegin(); it != z_order.rend(); it++){
+        Window* window = *it;
+        if(window->minimized)
+            continue;
+        Rectangle bounds = window->getGlobalBounds();
+        window->occluded = covered(bounds);
+        if(window->occluded){
+            culled++;
+            continue;
+        }
+        draw_list.push_back(window);
+        if(window->opaque)
+            covers.push_back(bounds);
+    }
+    for(auto it = draw_list.rbegin(); it != draw_list.rend(); it++)
+        (*it)->UIDraw();
+}
+
+void WindowManager::Update(){
+    for(Window* window : z_order){
+        if(window->suspendsUpdates())
+            continue;
+        window->Update();
+    }
+}
+
+bool WindowManager::onClick(Vector2 mouse_pos,MouseButton button){
+    for(auto it = z_order.rbegin(); it != z_order.rend(); it++){
+        Window* window = *it;
+        if(window->minimized || !CheckCollisionPointRec(mouse_pos,window->getGlobalBounds()))
+            continue;
+        if(window != z_order.back())
+            raise(window);
+        window->Click(mouse_pos,button);
+        return true;
+    }
+    return false;
+}
+
+bool WindowManager::onHover(Vector2 mouse_pos){
+    for(auto it = z_order.rbegin(); it != z_order.rend(); it++){
+        Window* window = *it;
+        if(window->minimized)
+            continue;
+        if(window->Hover(mouse_pos))
+            return true;
+        if(CheckCollisionPointRec(mouse_pos,window->getGlobalBounds()))
+            return false;
+    }
+    return false;
+}
+
 TextBox::TextBox(Vector2 offset,double font_size,int cols,std::function<void(string str)> submit_callback,bool reset = false, string text="",Color text_color=BLACK)
-    :UIComponent(nullptr,offset,{0,0}),MouseListener(),KeyboardListener(){
+    :UIComponent(nullptr,offset,{0,0}),KeyboardListener(),MouseListener(){
     padding = 2;
     this->text = new Text(Vector2{5,0},text,font_size,LEFT,text_color);
     this->text->parent = this;
     this->cols = cols;
     this->submit_callback = submit_callback;
     this->reset_on_enter = reset;
-    cursor_pos = 0;
-    frame_counter = new Counter(60,true);
-    repeat_counter = new Counter(repeat_delay,true);
-    start_counter = new Counter(start_delay,false);
+    initTimers();
     dimension = calculateDimension();
 
     background = new Background(UIComponent::default_background_color);
@@ -833,64 +2323,84 @@ TextBox::TextBox(Vector2 offset,double font_size,int cols,std::function<void(str
     init();
 }
 
+// Takes an already sized text and caller-owned styles, so nothing is
+// allocated or measured here.
+TextBox::TextBox(Vector2 offset,Vector2 dimension,Text* text,int cols,std::function<void(string str)> submit_callback,Background* background,Border* border)
+    :UIComponent(nullptr,offset,dimension),KeyboardListener(),MouseListener(){
+    padding = 2;
+    this->text = text;
+    this->text->parent = this;
+    this->cols = cols;
+    this->submit_callback = submit_callback;
+    this->reset_on_enter = false;
+    initTimers();
+    this->background = background;
+    addStyle(background);
+    this->border = border;
+    addStyle(border);
+    init();
+}
+
+void TextBox::initTimers(){
+    cursor_pos = 0;
+    caret_visible = false;
+    repeat_key = 0;
+    blink_timer.callback = [this](){
+        if(!isFocused()){
+            caret_visible = false;
+            blink_timer.stop();
+        } else
+            caret_visible = !caret_visible;
+        invalidate();
+    };
+    repeat_timer.callback = [this](){
+        if(!isFocused() || !context->input->isKeyDown(repeat_key))
+            return;
+        HandleKey(repeat_key);
+        repeat_timer.start(repeat_delay);
+    };
+}
+
 TextBox::~TextBox(){
-    delete frame_counter;
-    delete repeat_counter;
-    delete start_counter;
-    delete text;
+    release(text);
+}
+
+void TextBox::resetCaret(){
+    caret_visible = true;
+    blink_timer.start(blink_interval,true);
+    invalidate();
 }
 
 void TextBox::KeyPress(int key){
     HandleKey(key);
-    start_counter->count = 1;
-    start_count_done = false;
+    repeat_key = key;
+    repeat_timer.start(start_delay);
 }
 
-void TextBox::KeyType(int key) {
-    if(start_count_done){
-        if(repeat_counter->count == 0){
-            HandleKey(key);
-        }
-    }
-    if(start_counter->count >= start_delay){
-        HandleKey(key);
-        start_count_done = true;
-        repeat_counter->count = 0;
-    }
-}
+void TextBox::KeyType(int){}
 
 void TextBox::KeyRelease(int key){
-    repeat_counter->count = repeat_delay;
-    start_counter->count = 0;
-    start_count_done = false;
+    repeat_timer.stop();
 }
 
 void TextBox::HandleKey(int key){
-    frame_counter->count = 0;
-    bool shift_pressed = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+    resetCaret();
     if(key == KEY_BACKSPACE){
         if(text->str.size() > 0 && cursor_pos > 0){
             text->str.erase(cursor_pos - 1,1);
             cursor_pos--;
         }
     } else if(key >= 32 && key <= 126){
-        if(text->str.size() < cols){
-            char c = (char)key;
-            if(c >= 'A' && c <= 'Z' && !shift_pressed)
-                c += 32;
-            else if (shift_pressed && shift_map.find(c) != shift_map.end())
-                c = shift_map[c];
-            text->str.insert(cursor_pos,1,c);
+        if(text->str.size() < (size_t)cols){
+            text->str.insert(cursor_pos,1,translateKey(key));
             cursor_pos++;
         }
     } else if(key == KEY_LEFT){
         if(cursor_pos > 0)
             cursor_pos--;
-        frame_counter->count = 0;
     } else if(key == KEY_RIGHT){
-        if(cursor_pos < text->str.size())
+        if(cursor_pos < (int)text->str.size())
             cursor_pos++;
-        frame_counter->count = 0;
     } else if(key == KEY_ENTER){
         if(submit_callback != nullptr)
             submit_callback(text->str);
@@ -900,27 +2410,45 @@ void TextBox::HandleKey(int key){
         }
     }
     text->dimension = text->calculateDimension();
+    publish();
 } 
 
+void TextBox::bind(Observable<string>& cell){
+    cell.subscribe(binding,[this](const string& val){
+        if(text->str == val)
+            return;
+        text->str = val;
+        cursor_pos = min(cursor_pos,(int)val.size());
+        text->dimension = text->calculateDimension();
+        invalidate();
+    });
+}
+
+void TextBox::publish(){
+    if(binding.bound())
+        static_cast<Observable<string>*>(binding.source)->set(text->str);
+}
+
+float TextBox::caretX(int pos){
+    float x = 5;
+    for(int i = 0; i < pos && i < (int)text->str.size(); i++)
+        x += glyphAdvance(text->str[i],text->size);
+    return x;
+}
+
 void TextBox::Draw(){
     Vector2 offset = getGlobalOffset();
-    Vector2 dim = dimension;
-    Vector2 text_width = MeasureTextEx(font," ",text->size,2); 
-    double cursor_x = offset.x + (padding + text_width.x) * cursor_pos + 5;
+    double cursor_x = offset.x + caretX(cursor_pos);
     text->UIDraw();
-    if(frame_counter->count < 30 && isFocused()){
-        DrawLine(cursor_x,offset.y,cursor_x,offset.y + text->size,text->text_color);
+    if(caret_visible && isFocused()){
+        context->renderer->drawLine({(float)cursor_x,offset.y},{(float)cursor_x,offset.y + text->size},text->text_color);
     }
 }
 
-void TextBox::Update(){
-    frame_counter->Tick();
-    repeat_counter->Tick();
-    start_counter->Tick();
-}
+void TextBox::Update(){}
 
 Vector2 TextBox::calculateDimension(){
-    Vector2 dim = MeasureTextEx(font," ",text->size,2);
+    Vector2 dim = MeasureTextEx(context->font," ",text->size,2);
     dim.x = (dim.x  + padding) * cols + 5;
     dim.y = text->size;
     return dim;
@@ -932,14 +2460,28 @@ bool TextBox::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void TextBox::accountMemory(MemoryReport& report){
+    size_t callbacks = sizeof(submit_callback) + sizeof(blink_timer.callback) + sizeof(repeat_timer.callback);
+    report.addComponent("TextBox",sizeof(TextBox) - callbacks);
+    report.add(MEMORY_CALLBACKS,callbacks);
+    accountStyles(report);
+    text->accountMemory(report);
+}
+
 bool TextBox::onClick(Vector2 mousePos,MouseButton button) {
     Vector2 offset = getGlobalOffset();
-    Vector2 text_width = MeasureTextEx(font," ",text->size,2);
-    double char_width = text_width.x + padding;
-    int char_pos = (mousePos.x - offset.x + char_width / 2) / char_width;
-    cursor_pos = char_pos > text->str.size() ? text->str.size() : char_pos;
-    frame_counter->count = 0;
-    focus = this;
+    float x = mousePos.x - offset.x;
+    cursor_pos = 0;
+    float left = caretX(0);
+    while(cursor_pos < (int)text->str.size()){
+        float right = left + glyphAdvance(text->str[cursor_pos],text->size);
+        if(x < (left + right) / 2)
+            break;
+        left = right;
+        cursor_pos++;
+    }
+    context->keyboard_focus = this;
+    resetCaret();
     return true;
 }
 
@@ -955,13 +2497,29 @@ CheckBox::CheckBox(Vector2 offset,Vector2 dimension,bool checked):UIComponent(nu
     init();
 }
 
+CheckBox::CheckBox(Vector2 offset,Vector2 dimension,bool checked,Background* background,Border* border)
+:UIComponent(nullptr,offset,dimension),MouseListener(){
+    this->checked = checked;
+    this->background = background;
+    this->border = border;
+    background->color = checked ? checked_color : unchecked_color;
+    border->margin_color = default_margin_color;
+    addStyle(background);
+    addStyle(border);
+    margin_color = default_margin_color;
+    init();
+}
+
 CheckBox::~CheckBox(){}
 
 void CheckBox::Draw(){}
 
-void CheckBox::Update(){
+void CheckBox::Update(){}
+
+void CheckBox::setChecked(bool checked){
+    this->checked = checked;
     background->color = checked ? checked_color : unchecked_color;
-    border->margin_color = margin_color;
+    invalidate();
 }
 
 bool CheckBox::setBounds(Vector2 off,Vector2 dim){
@@ -970,15 +2528,34 @@ bool CheckBox::setBounds(Vector2 off,Vector2 dim){
     return true;
 }
 
+void CheckBox::accountMemory(MemoryReport& report){
+    report.addComponent("CheckBox",sizeof(CheckBox));
+    accountStyles(report);
+}
+
+void CheckBox::bind(Observable<bool>& cell){
+    cell.subscribe(binding,[this](const bool& val){
+        setChecked(val);
+    });
+}
+
 bool CheckBox::onClick(Vector2 mousePos,MouseButton button){
-    checked = !checked;
+    setChecked(!checked);
+    if(binding.bound())
+        static_cast<Observable<bool>*>(binding.source)->set(checked);
     return true;
 }
 
-bool CheckBox::onHover(Vector2 mousePos){
-    border->margin_color = hover_margin_color;
+void CheckBox::onMouseEnter(){
     margin_color = hover_margin_color;
-    return true;
+    border->margin_color = margin_color;
+    invalidate();
+}
+
+void CheckBox::onMouseLeave(){
+    margin_color = default_margin_color;
+    border->margin_color = margin_color;
+    invalidate();
 }
 
 Field::Field(Vector2 pos,Vector2 dimension,string text,int cols,float font_size,std::function<void(string str)> submit,Color text_color):UIComponent(nullptr,pos,dimension){
@@ -994,8 +2571,19 @@ Field::Field(Vector2 pos,Vector2 dimension,string text,int cols,float font_size,
     init();
 }
 
+// Wraps a row whose label and text box are already placed, as built by
+// FixedField; the row sits at the field's origin.
+Field::Field(Vector2 pos,Vector2 dimension,Container* container,Text* text,TextBox* text_box):UIComponent(nullptr,pos,dimension){
+    this->container = container;
+    this->text = text;
+    this->text_box = text_box;
+    this->spacer = nullptr;
+    container->parent = this;
+    init();
+}
+
 Field::~Field(){
-    delete container;
+    release(container);
 }
 
 bool Field::onClick(Vector2 pos,MouseButton button){
@@ -1015,6 +2603,12 @@ bool Field::setBounds(Vector2 pos,Vector2 dimension){
     return true;
 }
 
+void Field::accountMemory(MemoryReport& report){
+    report.addComponent("Field",sizeof(Field));
+    accountStyles(report);
+    container->accountMemory(report);
+}
+
 Slider::Slider(Vector2 offset,Vector2 dimension,std::function<void(float)> change_callback,float current,float slider_scale,Layout l):UIComponent(nullptr,offset,dimension),MouseListener(),Draggable(){
     this->l = l;
     this->change_callback = change_callback;
@@ -1034,7 +2628,7 @@ void Slider::Draw(){
     offset.x = l == HORIZONTAL ? offset.x + slider_percent * (dimension.x - slider_width) : offset.x;
     offset.y = l == VERTICAL ? offset.y + slider_percent * (dimension.y - slider_width) : offset.y;
     Vector2 slider_bounds = l == HORIZONTAL ? Vector2{slider_width,dimension.y} : Vector2{dimension.x,slider_width};
-    DrawRectangleV(offset,slider_bounds,DARKGRAY);
+    context->renderer->drawRectangle(Rectangle{offset.x,offset.y,slider_bounds.x,slider_bounds.y},DARKGRAY);
 }
 
 bool Slider::setBounds(Vector2 offset,Vector2 dimension){
@@ -1043,16 +2637,36 @@ bool Slider::setBounds(Vector2 offset,Vector2 dimension){
     return true;
 }
 
+void Slider::accountMemory(MemoryReport& report){
+    report.addComponent("Slider",sizeof(Slider) - sizeof(change_callback));
+    report.add(MEMORY_CALLBACKS,sizeof(change_callback));
+    accountStyles(report);
+}
+
 bool Slider::onClick(Vector2 mouse_pos,MouseButton button){
     Vector2 offset = getGlobalOffset();
     Vector2 click_pos = {mouse_pos.x - offset.x,mouse_pos.y - offset.y};
     float click_percent = l == HORIZONTAL ? click_pos.x / dimension.x : click_pos.y / dimension.y;
     change_callback(click_percent);
     current = click_percent;
-    Draggable::focus = this;
+    if(binding.bound())
+        static_cast<Observable<float>*>(binding.source)->set(current);
+    invalidate();
+    context->drag_focus = this;
     return true;
 }
 
+void Slider::bind(Observable<float>& cell){
+    cell.subscribe(binding,[this](const float& val){
+        if(current == val)
+            return;
+        current = val;
+        if(change_callback != nullptr)
+            change_callback(val);
+        invalidate();
+    });
+}
+
 void Slider::onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button){
     Vector2 offset = getGlobalOffset();
     Vector2 click_pos = {mouse_pos.x + delta.x - offset.x,mouse_pos.y + delta.y - offset.y};
@@ -1060,6 +2674,9 @@ void Slider::onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button){
     click_percent = max(.0f,min(1.0f,click_percent));
     change_callback(click_percent);
     current = click_percent;
+    if(binding.bound())
+        static_cast<Observable<float>*>(binding.source)->set(current);
+    invalidate();
 }
 
 void Slider::Update(){}
@@ -1070,6 +2687,7 @@ ScrollPane::ScrollPane(UIComponent* c,Vector2 dim):UIComponent(nullptr,c->offset
     dimension = {dim.x + 10,dim.y};
     scroll_bar = new Slider({c->offset.x + c->dimension.x,c->offset.y},{10,dim.y},[this](float val){
         view->offset.y = -val * (view->dimension.y - dimension.y);
+        invalidate();
     });
     isListener = dynamic_cast<MouseListener*>(c) != nullptr;
     c->parent = this;
@@ -1099,6 +2717,13 @@ bool ScrollPane::setBounds(Vector2 offset,Vector2 dimension){
     return true;
 }
 
+void ScrollPane::accountMemory(MemoryReport& report){
+    report.addComponent("ScrollPane",sizeof(ScrollPane));
+    accountStyles(report);
+    view->accountMemory(report);
+    scroll_bar->accountMemory(report);
+}
+
 bool ScrollPane::onClick(Vector2 mouse_pos,MouseButton button){
     if(isListener)
         return dynamic_cast<MouseListener*>(view)->Click(mouse_pos,button) || scroll_bar->Click(mouse_pos,button);
@@ -1111,3 +2736,3018 @@ bool ScrollPane::onHover(Vector2 mouse_pos){
     return scroll_bar->Hover(mouse_pos);
 }
 
+GapBuffer::GapBuffer(size_t capacity){
+    buffer = vector<char>(capacity);
+    gap_start = 0;
+    gap_end = capacity;
+}
+
+size_t GapBuffer::size(){
+    return buffer.size() - (gap_end - gap_start);
+}
+
+char GapBuffer::at(size_t pos){
+    return pos < gap_start ? buffer[pos] : buffer[pos + gap_end - gap_start];
+}
+
+void GapBuffer::moveGap(size_t pos){
+    if(pos < gap_start){
+        size_t n = gap_start - pos;
+        memmove(buffer.data() + gap_end - n,buffer.data() + pos,n);
+        gap_start -= n;
+        gap_end -= n;
+    } else if(pos > gap_start){
+        size_t n = pos - gap_start;
+        memmove(buffer.data() + gap_start,buffer.data() + gap_end,n);
+        gap_start += n;
+        gap_end += n;
+    }
+}
+
+void GapBuffer::grow(size_t needed){
+    if(gap_end - gap_start >= needed)
+        return;
+    size_t back = buffer.size() - gap_end;
+    size_t capacity = max(buffer.size() * 2,size() + needed + 64);
+    vector<char> grown(capacity);
+    memcpy(grown.data(),buffer.data(),gap_start);
+    memcpy(grown.data() + capacity - back,buffer.data() + gap_end,back);
+    gap_end = capacity - back;
+    buffer.swap(grown);
+}
+
+void GapBuffer::insert(size_t pos,const char* str,size_t n){
+    moveGap(pos);
+    grow(n);
+    memcpy(buffer.data() + gap_start,str,n);
+    gap_start += n;
+}
+
+void GapBuffer::erase(size_t pos,size_t n){
+    moveGap(pos);
+    gap_end = min(gap_end + n,buffer.size());
+}
+
+void GapBuffer::copy(size_t pos,size_t n,char* out){
+    size_t front = pos < gap_start ? min(n,gap_start - pos) : 0;
+    memcpy(out,buffer.data() + pos,front);
+    memcpy(out + front,buffer.data() + pos + front + gap_end - gap_start,n - front);
+}
+
+string GapBuffer::substr(size_t pos,size_t n){
+    string str(n,'\0');
+    if(n > 0)
+        copy(pos,n,&str[0]);
+    return str;
+}
+
+void GapBuffer::clear(){
+    gap_start = 0;
+    gap_end = buffer.size();
+}
+
+LineTable::LineTable(){
+    gap_start = 0;
+    gap_end = 0;
+    text_size = 0;
+}
+
+size_t LineTable::size(){
+    return storage.size() - (gap_end - gap_start);
+}
+
+TextLine& LineTable::operator[](size_t i){
+    return i < gap_start ? storage[i] : storage[i + gap_end - gap_start];
+}
+
+size_t LineTable::start(size_t i){
+    return i < gap_start ? storage[i].anchor : text_size - storage[i + gap_end - gap_start].anchor;
+}
+
+// Lines crossing the gap switch between start and end-relative anchors.
+void LineTable::moveGap(size_t i){
+    while(gap_start > i){
+        gap_start--;
+        gap_end--;
+        storage[gap_end] = std::move(storage[gap_start]);
+        storage[gap_end].anchor = text_size - storage[gap_end].anchor;
+    }
+    while(gap_start < i){
+        storage[gap_start] = std::move(storage[gap_end]);
+        storage[gap_start].anchor = text_size - storage[gap_start].anchor;
+        gap_start++;
+        gap_end++;
+    }
+}
+
+void LineTable::grow(size_t needed){
+    if(gap_end - gap_start >= needed)
+        return;
+    size_t back = storage.size() - gap_end;
+    size_t capacity = max(storage.size() * 2,size() + needed + 16);
+    vector<TextLine> grown(capacity);
+    std::move(storage.begin(),storage.begin() + gap_start,grown.begin());
+    std::move(storage.begin() + gap_end,storage.end(),grown.end() - back);
+    gap_end = capacity - back;
+    storage.swap(grown);
+}
+
+// added carries plain starts; the lines land just before the gap.
+void LineTable::insert(size_t i,vector<TextLine>& added){
+    moveGap(i);
+    grow(added.size());
+    for(TextLine& line : added)
+        storage[gap_start++] = std::move(line);
+}
+
+void LineTable::erase(size_t i){
+    moveGap(i + 1);
+    gap_start--;
+    storage[gap_start] = TextLine{};
+}
+
+void LineTable::push_back(TextLine line){
+    moveGap(size());
+    grow(1);
+    storage[gap_start++] = std::move(line);
+}
+
+// The text changed by delta at the gap: between the starts of the lines
+// before it and those after it.
+void LineTable::shift(long delta){
+    text_size += delta;
+}
+
+void LineTable::clear(size_t text_size){
+    storage.clear();
+    gap_start = 0;
+    gap_end = 0;
+    this->text_size = text_size;
+}
+
+TextArea::TextArea(Vector2 offset,Vector2 dimension,float font_size,string str,Color text_color)
+:UIComponent(nullptr,offset,dimension),KeyboardListener(),MouseListener(){
+    size = font_size;
+    padding = 5;
+    this->text_color = text_color;
+    caret_visible = false;
+    repeat_key = 0;
+    blink_timer.callback = [this](){
+        if(!isFocused()){
+            caret_visible = false;
+            blink_timer.stop();
+        } else
+            caret_visible = !caret_visible;
+        invalidate();
+    };
+    repeat_timer.callback = [this](){
+        if(!isFocused() || !context->input->isKeyDown(repeat_key))
+            return;
+        HandleKey(repeat_key);
+        repeat_timer.start(repeat_delay);
+    };
+    setText(str);
+    background = new Background(UIComponent::default_background_color);
+    addStyle(background);
+    border = new Border(2,UIComponent::secondary_color);
+    addStyle(border);
+    init();
+}
+
+TextArea::~TextArea(){}
+
+void TextArea::setText(const string& str){
+    buffer.clear();
+    buffer.insert(0,str.data(),str.size());
+    lines.clear(str.size());
+    size_t start = 0;
+    for(size_t i = 0; i < str.size(); i++){
+        if(str[i] == '\n'){
+            lines.push_back(TextLine{start,i - start,true,{}});
+            start = i + 1;
+        }
+    }
+    lines.push_back(TextLine{start,str.size() - start,true,{}});
+    invalidate();
+    cursor_line = 0;
+    cursor_col = 0;
+    preferred_x = -1;
+    first_line = 0;
+    scroll_x = 0;
+}
+
+string TextArea::getText(){
+    return buffer.substr(0,buffer.size());
+}
+
+size_t TextArea::cursorIndex(){
+    return lines.start(cursor_line) + cursor_col;
+}
+
+int TextArea::visibleLines(){
+    return max(1,(int)(dimension.y / size));
+}
+
+// Edits keep the line table's gap just after the cursor line, so the lines
+// below follow the text without being rewritten.
+void TextArea::insertText(const char* str,size_t n){
+    size_t pos = cursorIndex();
+    size_t tail = lines[cursor_line].length - cursor_col;
+    lines.moveGap(cursor_line + 1);
+    buffer.insert(pos,str,n);
+    lines.shift(n);
+    vector<TextLine> added;
+    size_t seg_start = 0;
+    for(size_t i = 0; i < n; i++){
+        if(str[i] != '\n')
+            continue;
+        if(added.empty())
+            lines[cursor_line].length = cursor_col + i;
+        else
+            added.back().length = i - seg_start;
+        added.push_back(TextLine{pos + i + 1,0,true,{}});
+        seg_start = i + 1;
+    }
+    lines[cursor_line].dirty = true;
+    if(added.empty()){
+        lines[cursor_line].length += n;
+        cursor_col += n;
+    } else {
+        added.back().length = n - seg_start + tail;
+        lines.insert(cursor_line + 1,added);
+        cursor_line += added.size();
+        cursor_col = n - seg_start;
+    }
+    preferred_x = -1;
+    scrollToCursor();
+}
+
+void TextArea::paste(){
+    const char* clipboard = GetClipboardText();
+    if(clipboard == nullptr)
+        return;
+    string str;
+    for(const char* c = clipboard; *c != '\0'; c++){
+        if(*c != '\r')
+            str.push_back(*c);
+    }
+    insertText(str.data(),str.size());
+}
+
+void TextArea::eraseBefore(){
+    if(cursor_col > 0){
+        lines.moveGap(cursor_line + 1);
+        buffer.erase(cursorIndex() - 1,1);
+        lines[cursor_line].length--;
+        lines[cursor_line].dirty = true;
+        cursor_col--;
+    } else if(cursor_line > 0){
+        size_t pos = cursorIndex() - 1;
+        size_t length = lines[cursor_line].length;
+        lines.erase(cursor_line);
+        buffer.erase(pos,1);
+        cursor_line--;
+        TextLine& prev = lines[cursor_line];
+        cursor_col = prev.length;
+        prev.length += length;
+        prev.dirty = true;
+    } else
+        return;
+    lines.shift(-1);
+    preferred_x = -1;
+    scrollToCursor();
+}
+
+void TextArea::eraseAfter(){
+    if(cursor_col < (int)lines[cursor_line].length){
+        lines.moveGap(cursor_line + 1);
+        buffer.erase(cursorIndex(),1);
+        lines[cursor_line].length--;
+    } else if(cursor_line + 1 < (int)lines.size()){
+        size_t length = lines[cursor_line + 1].length;
+        lines.erase(cursor_line + 1);
+        buffer.erase(cursorIndex(),1);
+        lines[cursor_line].length += length;
+    } else
+        return;
+    lines[cursor_line].dirty = true;
+    lines.shift(-1);
+    preferred_x = -1;
+}
+
+void TextArea::measureLine(int index){
+    TextLine& line = lines[index];
+    if(!line.dirty && line.caret_x.size() == line.length + 1)
+        return;
+    line_buffer.resize(line.length);
+    if(line.length > 0)
+        buffer.copy(lines.start(index),line.length,&line_buffer[0]);
+    line.caret_x.resize(line.length + 1);
+    float x = 0;
+    for(size_t i = 0; i < line.length; i++){
+        line.caret_x[i] = x;
+        x += glyphAdvance((unsigned char)line_buffer[i],size);
+    }
+    line.caret_x[line.length] = x;
+    line.dirty = false;
+}
+
+int TextArea::hitTestLine(int index,float x){
+    measureLine(index);
+    vector<float>& caret_x = lines[index].caret_x;
+    int col = lower_bound(caret_x.begin(),caret_x.end(),x) - caret_x.begin();
+    if(col >= (int)caret_x.size())
+        return caret_x.size() - 1;
+    if(col > 0 && x - caret_x[col - 1] < caret_x[col] - x)
+        col--;
+    return col;
+}
+
+void TextArea::scrollToCursor(){
+    int visible = visibleLines();
+    if(cursor_line < first_line)
+        first_line = cursor_line;
+    if(cursor_line >= first_line + visible)
+        first_line = cursor_line - visible + 1;
+    measureLine(cursor_line);
+    float x = lines[cursor_line].caret_x[cursor_col];
+    float width = dimension.x - 2 * padding;
+    if(x < scroll_x)
+        scroll_x = x;
+    if(x > scroll_x + width)
+        scroll_x = x - width;
+}
+
+void TextArea::moveLines(int delta){
+    if(preferred_x < 0){
+        measureLine(cursor_line);
+        preferred_x = lines[cursor_line].caret_x[cursor_col];
+    }
+    cursor_line = max(0,min((int)lines.size() - 1,cursor_line + delta));
+    cursor_col = hitTestLine(cursor_line,preferred_x);
+    float x = preferred_x;
+    scrollToCursor();
+    preferred_x = x;
+}
+
+void TextArea::Draw(){
+    Vector2 offset = getGlobalOffset();
+    float width = dimension.x - 2 * padding;
+    int last = min((int)lines.size(),first_line + visibleLines() + 1);
+    for(int i = first_line; i < last; i++){
+        measureLine(i);
+        TextLine& line = lines[i];
+        vector<float>& caret_x = line.caret_x;
+        int start = upper_bound(caret_x.begin(),caret_x.end(),scroll_x) - caret_x.begin() - 1;
+        int end = lower_bound(caret_x.begin(),caret_x.end(),scroll_x + width) - caret_x.begin() + 1;
+        start = max(start,0);
+        end = min(end,(int)line.length);
+        if(end <= start)
+            continue;
+        line_buffer.resize(end - start);
+        buffer.copy(lines.start(i) + start,end - start,&line_buffer[0]);
+        Vector2 pos = {offset.x + padding - scroll_x + caret_x[start],offset.y + (i - first_line) * size};
+        context->renderer->drawText(line_buffer.c_str(),pos,size,2,text_color);
+    }
+    if(caret_visible && isFocused()){
+        measureLine(cursor_line);
+        float x = offset.x + padding - scroll_x + lines[cursor_line].caret_x[cursor_col];
+        float y = offset.y + (cursor_line - first_line) * size;
+        context->renderer->drawLine({x,y},{x,y + size},text_color);
+    }
+}
+
+void TextArea::Update(){}
+
+bool TextArea::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    return true;
+}
+
+void TextArea::accountMemory(MemoryReport& report){
+    size_t callbacks = sizeof(blink_timer.callback) + sizeof(repeat_timer.callback);
+    report.addComponent("TextArea",sizeof(TextArea) - callbacks);
+    report.add(MEMORY_CALLBACKS,callbacks);
+    accountStyles(report);
+    report.add(MEMORY_BUFFERS,heapBytes(buffer.buffer) + heapBytes(lines.storage));
+    for(TextLine& line : lines.storage)
+        report.add(MEMORY_BUFFERS,heapBytes(line.caret_x));
+    report.add(MEMORY_STRINGS,heapBytes(line_buffer));
+}
+
+bool TextArea::onClick(Vector2 mouse_pos,MouseButton){
+    Vector2 offset = getGlobalOffset();
+    int line = first_line + (int)((mouse_pos.y - offset.y) / size);
+    cursor_line = max(0,min((int)lines.size() - 1,line));
+    cursor_col = hitTestLine(cursor_line,mouse_pos.x - offset.x - padding + scroll_x);
+    preferred_x = -1;
+    context->keyboard_focus = this;
+    resetCaret();
+    return true;
+}
+
+void TextArea::resetCaret(){
+    caret_visible = true;
+    blink_timer.start(blink_interval,true);
+    invalidate();
+}
+
+void TextArea::KeyPress(int key){
+    HandleKey(key);
+    repeat_key = key;
+    repeat_timer.start(start_delay);
+}
+
+void TextArea::KeyType(int){}
+
+void TextArea::KeyRelease(int){
+    repeat_timer.stop();
+}
+
+void TextArea::HandleKey(int key){
+    resetCaret();
+    bool ctrl_pressed = context->input->isKeyDown(KEY_LEFT_CONTROL) || context->input->isKeyDown(KEY_RIGHT_CONTROL);
+    if(ctrl_pressed){
+        if(key == KEY_V)
+            paste();
+        return;
+    }
+    if(key == KEY_BACKSPACE){
+        eraseBefore();
+    } else if(key == KEY_DELETE){
+        eraseAfter();
+    } else if(key == KEY_ENTER){
+        insertText("\n",1);
+    } else if(key == KEY_TAB){
+        string spaces(tab_width,' ');
+        insertText(spaces.data(),spaces.size());
+    } else if(key >= 32 && key <= 126){
+        char c = translateKey(key);
+        insertText(&c,1);
+    } else if(key == KEY_LEFT){
+        if(cursor_col > 0)
+            cursor_col--;
+        else if(cursor_line > 0){
+            cursor_line--;
+            cursor_col = lines[cursor_line].length;
+        }
+        preferred_x = -1;
+        scrollToCursor();
+    } else if(key == KEY_RIGHT){
+        if(cursor_col < (int)lines[cursor_line].length)
+            cursor_col++;
+        else if(cursor_line + 1 < (int)lines.size()){
+            cursor_line++;
+            cursor_col = 0;
+        }
+        preferred_x = -1;
+        scrollToCursor();
+    } else if(key == KEY_HOME){
+        cursor_col = 0;
+        preferred_x = -1;
+        scrollToCursor();
+    } else if(key == KEY_END){
+        cursor_col = lines[cursor_line].length;
+        preferred_x = -1;
+        scrollToCursor();
+    } else if(key == KEY_UP){
+        moveLines(-1);
+    } else if(key == KEY_DOWN){
+        moveLines(1);
+    } else if(key == KEY_PAGE_UP){
+        moveLines(-visibleLines());
+    } else if(key == KEY_PAGE_DOWN){
+        moveLines(visibleLines());
+    }
+}
+
+LogBuffer::LogBuffer(size_t max_lines,size_t max_bytes){
+    data = vector<char>(max_bytes);
+    lines = vector<LogLine>(max_lines);
+    first_line = 0;
+    line_count = 0;
+    bytes_written = 0;
+    changed = false;
+    open_line = false;
+}
+
+size_t LogBuffer::size(){
+    return line_count - first_line;
+}
+
+LogLine& LogBuffer::line(size_t index){
+    return lines[index % lines.size()];
+}
+
+void LogBuffer::writeBytes(const char* str,size_t n){
+    size_t offset = bytes_written % data.size();
+    size_t front = min(n,data.size() - offset);
+    memcpy(data.data() + offset,str,front);
+    memcpy(data.data(),str + front,n - front);
+    bytes_written += n;
+}
+
+void LogBuffer::pushLine(const char* str,size_t n,Color color){
+    n = min(n,data.size());
+    if(size() == lines.size())
+        first_line++;
+    while(first_line < line_count && bytes_written + n - line(first_line).start > data.size())
+        first_line++;
+    line(line_count) = LogLine{bytes_written,(unsigned int)n,color};
+    line_count++;
+    writeBytes(str,n);
+}
+
+// Grows the last line, which is always the most recently written bytes.
+void LogBuffer::extendLine(const char* str,size_t n){
+    LogLine& last = line(line_count - 1);
+    n = min(n,data.size() - last.length);
+    while(first_line + 1 < line_count && bytes_written + n - line(first_line).start > data.size())
+        first_line++;
+    last.length += n;
+    writeBytes(str,n);
+}
+
+// Text after the last newline stays an open line that later appends extend,
+// so producers may stream a line in several chunks.
+void LogBuffer::append(const char* str,size_t n,Color color){
+    lock_guard<mutex> guard(lock);
+    size_t start = 0;
+    for(size_t i = 0; i <= n; i++){
+        if(i < n && str[i] != '\n')
+            continue;
+        if(i == n && start == n)
+            break;
+        if(open_line)
+            extendLine(str + start,i - start);
+        else
+            pushLine(str + start,i - start,color);
+        open_line = i == n;
+        start = i + 1;
+    }
+    changed = true;
+}
+
+void LogBuffer::append(const vector<string>& strs,Color color){
+    lock_guard<mutex> guard(lock);
+    open_line = false;
+    for(const string& str : strs)
+        pushLine(str.data(),str.size(),color);
+    changed = true;
+}
+
+void LogBuffer::copy(const LogLine& line,size_t n,char* out){
+    size_t offset = line.start % data.size();
+    size_t front = min(n,data.size() - offset);
+    memcpy(out,data.data() + offset,front);
+    memcpy(out + front,data.data(),n - front);
+}
+
+void LogBuffer::clear(){
+    lock_guard<mutex> guard(lock);
+    first_line = line_count;
+    open_line = false;
+    changed = true;
+}
+
+LogView::LogView(Vector2 offset,Vector2 dimension,size_t max_lines,size_t max_bytes,float font_size,Color text_color)
+:UIComponent(nullptr,offset,dimension),MouseListener(),buffer(max_lines,max_bytes){
+    size = font_size;
+    narrowest = 0;
+    this->text_color = text_color;
+    top_line = 0;
+    follow = true;
+    background = new Background(UIComponent::default_background_color);
+    addStyle(background);
+    scroll_bar = new Slider({dimension.x - 10,0},{10,dimension.y},[this](float val){
+        scrollTo(val);
+    },1);
+    scroll_bar->parent = this;
+    startTicking();
+    init();
+}
+
+LogView::~LogView(){
+    delete scroll_bar;
+}
+
+void LogView::append(const string& str){
+    buffer.append(str.data(),str.size(),text_color);
+}
+
+void LogView::append(const string& str,Color color){
+    buffer.append(str.data(),str.size(),color);
+}
+
+void LogView::append(const vector<string>& strs){
+    buffer.append(strs,text_color);
+}
+
+void LogView::clear(){
+    buffer.clear();
+    follow = true;
+}
+
+int LogView::visibleLines(){
+    return max(1,(int)(dimension.y / size));
+}
+
+void LogView::scrollTo(float percent){
+    lock_guard<mutex> guard(buffer.lock);
+    size_t visible = visibleLines();
+    size_t retained = buffer.size();
+    size_t range = retained > visible ? retained - visible : 0;
+    top_line = buffer.first_line + (size_t)(max(0.0f,min(1.0f,percent)) * range);
+    follow = percent >= .999f;
+    invalidate();
+}
+
+void LogView::scrollLines(long delta){
+    lock_guard<mutex> guard(buffer.lock);
+    size_t visible = visibleLines();
+    size_t bottom = buffer.size() > visible ? buffer.line_count - visible : buffer.first_line;
+    long line = (long)top_line + delta;
+    top_line = max((long)buffer.first_line,min((long)bottom,line));
+    follow = top_line == bottom;
+    invalidate();
+}
+
+// Copies the visible lines out under the buffer lock and measures and draws
+// them after releasing it, so producers only wait for the copy. Each line is
+// copied up to as many characters as the narrowest glyph would fit.
+void LogView::Draw(){
+    Vector2 offset = getGlobalOffset();
+    float width = dimension.x - scroll_bar->dimension.x;
+    if(narrowest <= 0){
+        narrowest = width;
+        for(int c = 33; c < 127; c++)
+            narrowest = min(narrowest,glyphAdvance(c,size));
+        narrowest = max(narrowest,1.0f);
+    }
+    size_t visible = visibleLines();
+    size_t max_chars = (size_t)(width / narrowest) + 1;
+    size_t retained;
+    snapshot.clear();
+    snapshot_lines.clear();
+    {
+        lock_guard<mutex> guard(buffer.lock);
+        retained = buffer.size();
+        size_t bottom = retained > visible ? buffer.line_count - visible : buffer.first_line;
+        if(follow || top_line > bottom)
+            top_line = bottom;
+        top_line = max(top_line,buffer.first_line);
+        size_t last = min(buffer.line_count,top_line + visible);
+        for(size_t i = top_line; i < last; i++){
+            LogLine& line = buffer.line(i);
+            size_t n = min((size_t)line.length,max_chars);
+            size_t start = snapshot.size();
+            snapshot.resize(start + n);
+            buffer.copy(line,n,&snapshot[start]);
+            snapshot_lines.push_back(LogLine{start,(unsigned int)n,line.color});
+        }
+        scroll_bar->current = retained > visible ? (float)(top_line - buffer.first_line) / (retained - visible) : 1;
+    }
+    for(size_t k = 0; k < snapshot_lines.size(); k++){
+        LogLine& line = snapshot_lines[k];
+        size_t fit = 0;
+        float x = 0;
+        while(fit < line.length && x < width)
+            x += glyphAdvance((unsigned char)snapshot[line.start + fit++],size);
+        line_buffer.assign(snapshot,line.start,fit);
+        context->renderer->drawText(line_buffer.c_str(),{offset.x + 2,offset.y + k * size},size,2,line.color);
+    }
+    scroll_bar->UIDraw();
+}
+
+// Appends may come from any thread, so they only flag the buffer and the
+// view invalidates its layer here, on the UI thread.
+void LogView::Update(){
+    if(buffer.changed.exchange(false))
+        invalidate();
+    if(!hovered)
+        return;
+    float wheel = context->input->mouseWheelMove();
+    if(wheel != 0)
+        scrollLines((long)(-wheel * 3));
+}
+
+bool LogView::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    scroll_bar->setBounds({dim.x - 10,0},{10,dim.y});
+    return true;
+}
+
+void LogView::accountMemory(MemoryReport& report){
+    report.addComponent("LogView",sizeof(LogView));
+    accountStyles(report);
+    report.add(MEMORY_BUFFERS,heapBytes(buffer.data) + heapBytes(buffer.lines) + heapBytes(snapshot_lines));
+    report.add(MEMORY_STRINGS,heapBytes(line_buffer) + heapBytes(snapshot));
+    scroll_bar->accountMemory(report);
+}
+
+bool LogView::onClick(Vector2 mouse_pos,MouseButton button){
+    return scroll_bar->Click(mouse_pos,button);
+}
+
+UICommandQueue::UICommandQueue(){
+    UICommand* stub = new UICommand();
+    stub->next.store(nullptr);
+    head.store(stub);
+    tail = stub;
+    depth.store(0);
+    posted.store(0);
+    executed = 0;
+    last_batch = 0;
+    last_latency_ms = 0;
+    max_latency_ms = 0;
+    total_latency_ms = 0;
+}
+
+UICommandQueue::~UICommandQueue(){
+    while(tail != nullptr){
+        UICommand* next = tail->next.load();
+        delete tail;
+        tail = next;
+    }
+}
+
+void UICommandQueue::post(std::function<void()> command){
+    UICommand* c = new UICommand();
+    c->next.store(nullptr,memory_order_relaxed);
+    c->run = std::move(command);
+    c->posted = chrono::steady_clock::now();
+    depth.fetch_add(1,memory_order_relaxed);
+    posted.fetch_add(1,memory_order_relaxed);
+    UICommand* prev = head.exchange(c,memory_order_acq_rel);
+    prev->next.store(c,memory_order_release);
+}
+
+void UICommandQueue::setText(Text* text,string str){
+    post([text,str](){
+        text->setText(str);
+    });
+}
+
+void UICommandQueue::setChecked(CheckBox* check_box,bool checked){
+    post([check_box,checked](){
+        check_box->setChecked(checked);
+    });
+}
+
+void UICommandQueue::toggle(CheckBox* check_box){
+    post([check_box](){
+        check_box->setChecked(!check_box->checked);
+    });
+}
+
+void UICommandQueue::addComponent(Container* container,UIComponent* component,bool listener){
+    post([container,component,listener](){
+        if(listener)
+            container->addBoth(component);
+        else
+            container->addComponent(component);
+    });
+}
+
+void UICommandQueue::removeComponent(Container* container,int id){
+    post([container,id](){
+        container->removeComponent(id);
+    });
+}
+
+void UICommandQueue::moveWindow(Window* window,Vector2 offset){
+    post([window,offset](){
+        window->offset = offset;
+        if(window->parent != nullptr)
+            window->parent->invalidate();
+    });
+}
+
+bool UICommandQueue::empty(){
+    return depth.load(memory_order_acquire) == 0;
+}
+
+size_t UICommandQueue::drain(size_t max_commands){
+    size_t limit = depth.load(memory_order_acquire);
+    if(max_commands != 0)
+        limit = min(limit,max_commands);
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    size_t count = 0;
+    double batch_latency = 0;
+    while(count < limit){
+        UICommand* next = tail->next.load(memory_order_acquire);
+        if(next == nullptr)
+            break;
+        delete tail;
+        tail = next;
+        double latency = chrono::duration<double,milli>(now - next->posted).count();
+        batch_latency = max(batch_latency,latency);
+        total_latency_ms += latency;
+        std::function<void()> command = std::move(next->run);
+        depth.fetch_sub(1,memory_order_relaxed);
+        command();
+        count++;
+    }
+    executed += count;
+    last_batch = count;
+    if(count > 0){
+        last_latency_ms = batch_latency;
+        max_latency_ms = max(max_latency_ms,batch_latency);
+    }
+    return count;
+}
+
+UICommandStats UICommandQueue::stats(){
+    UICommandStats s;
+    s.depth = depth.load(memory_order_relaxed);
+    s.posted = posted.load(memory_order_relaxed);
+    s.executed = executed;
+    s.last_batch = last_batch;
+    s.last_latency_ms = last_latency_ms;
+    s.max_latency_ms = max_latency_ms;
+    s.avg_latency_ms = executed > 0 ? total_latency_ms / executed : 0;
+    return s;
+}
+
+MutationQueue::MutationQueue(){
+    committed = 0;
+    last_batch = 0;
+}
+
+MutationQueue::~MutationQueue(){
+    for(Mutation& m : pending)
+        if(m.type == MUTATION_ADD && m.component->parent == nullptr)
+            UIComponent::release(m.component);
+}
+
+void MutationQueue::add(Container* container,UIComponent* component,bool listener){
+    pending.push_back({MUTATION_ADD,container,component,component->id,listener});
+}
+
+void MutationQueue::remove(Container* container,int id){
+    pending.push_back({MUTATION_REMOVE,container,nullptr,id,false});
+}
+
+void MutationQueue::reparent(UIComponent* component,Container* container,bool listener){
+    pending.push_back({MUTATION_REPARENT,container,component,component->id,listener});
+}
+
+void MutationQueue::raise(Window* window){
+    pending.push_back({MUTATION_RAISE,nullptr,window,window->id,false});
+}
+
+void MutationQueue::setBounds(UIComponent* component,Vector2 offset,Vector2 dimension){
+    pending.push_back({MUTATION_BOUNDS,nullptr,component,component->id,false,offset,dimension});
+}
+
+bool MutationQueue::empty(){
+    return pending.empty();
+}
+
+void MutationQueue::touch(UIComponent* component){
+    Container* container = dynamic_cast<Container*>(component);
+    if(container != nullptr && find(touched.begin(),touched.end(),container) == touched.end())
+        touched.push_back(container);
+}
+
+// Appends without layout; commit() relayouts each touched container once.
+void MutationQueue::attach(Mutation& m){
+    MouseListener* listener = m.listener ? dynamic_cast<MouseListener*>(m.component) : nullptr;
+    if(m.listener && listener == nullptr){
+        cout << "Error: Component is not a mouse listener" << endl;
+        return;
+    }
+    m.container->appendComponent(m.component);
+    if(listener != nullptr)
+        m.container->addListener(listener);
+    touch(m.container);
+}
+
+size_t MutationQueue::commit(){
+    size_t count = 0;
+    while(!pending.empty()){
+        applying.swap(pending);
+        for(Mutation& m : applying){
+            switch(m.type){
+                case MUTATION_ADD:
+                    attach(m);
+                    break;
+                case MUTATION_REMOVE: {
+                    UIComponent* c = m.container->detachComponent(m.id);
+                    if(c != nullptr)
+                        graveyard.push_back(c);
+                    touch(m.container);
+                    break;
+                }
+                case MUTATION_REPARENT: {
+                    Container* from = dynamic_cast<Container*>(m.component->parent);
+                    if(from != nullptr){
+                        from->detachComponent(m.id);
+                        touch(from);
+                    }
+                    attach(m);
+                    break;
+                }
+                case MUTATION_RAISE: {
+                    WindowManager* manager = dynamic_cast<WindowManager*>(m.component->parent);
+                    if(manager != nullptr)
+                        manager->raise(static_cast<Window*>(m.component));
+                    break;
+                }
+                case MUTATION_BOUNDS:
+                    m.component->setBounds(m.offset,m.dimension);
+                    m.component->invalidate();
+                    touch(m.component->parent);
+                    break;
+            }
+        }
+        count += applying.size();
+        applying.clear();
+    }
+    for(Container* container : touched){
+        StaticContainer* laid_out = dynamic_cast<StaticContainer*>(container);
+        if(laid_out != nullptr && laid_out->layout != FREE)
+            laid_out->relayout();
+        else
+            container->invalidate();
+    }
+    touched.clear();
+    // A component removed and re-added in the same batch has a parent again.
+    for(UIComponent* c : graveyard)
+        if(c->parent == nullptr)
+            UIComponent::release(c);
+    graveyard.clear();
+    if(count > 0)
+        MouseListener::invalidateHover();
+    committed += count;
+    last_batch = count;
+    return count;
+}
+
+GridDataSource::~GridDataSource(){}
+
+bool GridDataSource::lessThan(size_t a,size_t b,int col){
+    string str_a,str_b;
+    cellText(a,col,str_a);
+    cellText(b,col,str_b);
+    return str_a < str_b;
+}
+
+bool GridDataSource::concurrentReads(){
+    return false;
+}
+
+ColumnarDataSource::ColumnarDataSource(){
+    rows = 0;
+}
+
+void ColumnarDataSource::addColumn(string name,vector<double> values,int precision){
+    rows = columns.empty() ? values.size() : min(rows,values.size());
+    columns.push_back(GridColumn{name,std::move(values),{},precision});
+}
+
+void ColumnarDataSource::addColumn(string name,vector<string> values){
+    rows = columns.empty() ? values.size() : min(rows,values.size());
+    columns.push_back(GridColumn{name,{},std::move(values),0});
+}
+
+size_t ColumnarDataSource::rowCount(){
+    return rows;
+}
+
+int ColumnarDataSource::columnCount(){
+    return columns.size();
+}
+
+void ColumnarDataSource::columnName(int col,string& out){
+    out.assign(columns[col].name);
+}
+
+void ColumnarDataSource::cellText(size_t row,int col,string& out){
+    GridColumn& column = columns[col];
+    if(column.numbers.empty()){
+        out.assign(column.strings[row]);
+        return;
+    }
+    char buf[64];
+    int n = snprintf(buf,sizeof(buf),"%.*f",column.precision,column.numbers[row]);
+    out.assign(buf,max(0,min(n,(int)sizeof(buf) - 1)));
+}
+
+bool ColumnarDataSource::lessThan(size_t a,size_t b,int col){
+    GridColumn& column = columns[col];
+    if(column.numbers.empty())
+        return column.strings[a] < column.strings[b];
+    return column.numbers[a] < column.numbers[b];
+}
+
+bool ColumnarDataSource::concurrentReads(){
+    return true;
+}
+
+DataGrid::DataGrid(Vector2 offset,Vector2 dimension,GridDataSource* source,int frozen_columns,float font_size,Color text_color)
+:UIComponent(nullptr,offset,dimension),MouseListener(){
+    size = font_size;
+    row_height = font_size + 4;
+    this->text_color = text_color;
+    this->frozen_columns = frozen_columns;
+    first_row = 0;
+    scroll_x = 0;
+    sort_column = -1;
+    sort_ascending = true;
+    selected_row = -1;
+    background = new Background(UIComponent::default_background_color);
+    addStyle(background);
+    v_scroll = new Slider({dimension.x - 10,0},{10,dimension.y - 10},[this](float val){
+        size_t rows = this->source->rowCount();
+        size_t visible = visibleRows();
+        first_row = rows > visible ? (size_t)(val * (rows - visible)) : 0;
+        invalidate();
+    });
+    v_scroll->parent = this;
+    h_scroll = new Slider({0,dimension.y - 10},{dimension.x - 10,10},[this](float val){
+        float frozen_width = column_x[min(this->frozen_columns,(int)column_widths.size())];
+        float view_width = this->dimension.x - v_scroll->dimension.x - frozen_width;
+        scroll_x = max(0.0f,val * (column_x.back() - frozen_width - view_width));
+        invalidate();
+    },0,.1,HORIZONTAL);
+    h_scroll->parent = this;
+    setSource(source);
+    init();
+}
+
+DataGrid::~DataGrid(){
+    delete v_scroll;
+    delete h_scroll;
+}
+
+void DataGrid::setSource(GridDataSource* source){
+    this->source = source;
+    row_order.clear();
+    sort_column = -1;
+    first_row = 0;
+    scroll_x = 0;
+    selected_row = -1;
+    measureColumns();
+}
+
+void DataGrid::updateColumns(){
+    column_x.resize(column_widths.size() + 1);
+    column_x[0] = 0;
+    for(size_t i = 0; i < column_widths.size(); i++)
+        column_x[i + 1] = column_x[i] + column_widths[i];
+    invalidate();
+}
+
+void DataGrid::measureColumns(size_t sample_rows){
+    int columns = source->columnCount();
+    size_t rows = min(sample_rows,source->rowCount());
+    column_widths.assign(columns,0);
+    for(int c = 0; c < columns; c++){
+        source->columnName(c,cell_buffer);
+        float width = MeasureTextEx(context->font,cell_buffer.c_str(),size,2).x + 20;
+        for(size_t r = 0; r < rows; r++){
+            source->cellText(r,c,cell_buffer);
+            width = max(width,MeasureTextEx(context->font,cell_buffer.c_str(),size,2).x + 8);
+        }
+        column_widths[c] = max(40.0f,min(400.0f,width));
+    }
+    updateColumns();
+}
+
+void DataGrid::setColumnWidth(int col,float width){
+    column_widths[col] = width;
+    updateColumns();
+}
+
+void DataGrid::sortBy(int col,bool ascending){
+    sort_column = col;
+    sort_ascending = ascending;
+    sortRows();
+    selected_row = -1;
+    invalidate();
+}
+
+void DataGrid::sortRows(){
+    row_order.resize(source->rowCount());
+    iota(row_order.begin(),row_order.end(),0);
+    GridDataSource* source = this->source;
+    int col = sort_column;
+    bool ascending = sort_ascending;
+    auto less = [source,col,ascending](unsigned int a,unsigned int b){
+        return ascending ? source->lessThan(a,b,col) : source->lessThan(b,a,col);
+    };
+    if(source->concurrentReads())
+        parallelSort(row_order,less);
+    else
+        sort(row_order.begin(),row_order.end(),less);
+}
+
+// An order taken before the source changed size holds missing or stale
+// indices, so it falls back to source order until Draw re-sorts.
+size_t DataGrid::rowAt(size_t visual_row){
+    return row_order.size() != source->rowCount() ? visual_row : row_order[visual_row];
+}
+
+int DataGrid::visibleRows(){
+    return max(1,(int)((dimension.y - h_scroll->dimension.y) / row_height) - 1);
+}
+
+int DataGrid::columnAt(float view_x){
+    int frozen = min(frozen_columns,(int)column_widths.size());
+    float x = view_x < column_x[frozen] ? view_x : view_x + scroll_x;
+    int col = upper_bound(column_x.begin(),column_x.end(),x) - column_x.begin() - 1;
+    return col < (int)column_widths.size() ? col : -1;
+}
+
+void DataGrid::scrollRows(long delta){
+    size_t rows = source->rowCount();
+    size_t visible = visibleRows();
+    long bottom = rows > visible ? rows - visible : 0;
+    first_row = max(0L,min(bottom,(long)first_row + delta));
+    v_scroll->current = bottom > 0 ? (float)first_row / bottom : 0;
+    invalidate();
+}
+
+void DataGrid::drawCellText(float x,float y,float width,Color color){
+    size_t fit = 0;
+    float w = 4;
+    while(fit < cell_buffer.size()){
+        w += glyphAdvance((unsigned char)cell_buffer[fit],size);
+        if(w > width)
+            break;
+        fit++;
+    }
+    cell_buffer.resize(fit);
+    context->renderer->drawText(cell_buffer.c_str(),{x + 4,y + 2},size,2,color);
+}
+
+void DataGrid::drawColumn(int col,float x,Vector2 offset,size_t last_row,float view_height){
+    float width = column_widths[col];
+    float cell_x = offset.x + x;
+    source->columnName(col,cell_buffer);
+    if(sort_column == col)
+        cell_buffer += sort_ascending ? " ^" : " v";
+    drawCellText(cell_x,offset.y,width,text_color);
+    for(size_t r = first_row; r < last_row; r++){
+        source->cellText(rowAt(r),col,cell_buffer);
+        drawCellText(cell_x,offset.y + row_height * (1 + r - first_row),width,text_color);
+    }
+    context->renderer->drawLine({cell_x + width,offset.y},{cell_x + width,offset.y + view_height},grid_color);
+}
+
+void DataGrid::Draw(){
+    Vector2 offset = getGlobalOffset();
+    int columns = column_widths.size();
+    size_t rows = source->rowCount();
+    size_t visible = visibleRows();
+    float view_width = dimension.x - v_scroll->dimension.x;
+    float view_height = dimension.y - h_scroll->dimension.y;
+    int frozen = min(frozen_columns,columns);
+    float frozen_width = column_x[frozen];
+    if(sort_column != -1 && row_order.size() != rows)
+        sortRows();
+    first_row = min(first_row,rows > visible ? rows - visible : 0);
+    size_t last_row = min(rows,first_row + visible + 1);
+    context->renderer->drawRectangle(Rectangle{offset.x,offset.y,view_width,row_height},header_color);
+    if(selected_row >= (long)first_row && selected_row < (long)last_row)
+        context->renderer->drawRectangle(Rectangle{offset.x,offset.y + row_height * (1 + selected_row - first_row),view_width,row_height},selected_color);
+    int first_col = columnAt(frozen_width);
+    int start = first_col == -1 ? columns : max(first_col,frozen);
+    for(int c = start; c < columns && column_x[c] - scroll_x < view_width; c++)
+        drawColumn(c,column_x[c] - scroll_x,offset,last_row,view_height);
+    if(frozen > 0){
+        context->renderer->drawRectangle(Rectangle{offset.x,offset.y,frozen_width,row_height},header_color);
+        context->renderer->drawRectangle(Rectangle{offset.x,offset.y + row_height,frozen_width,view_height - row_height},background->color);
+        if(selected_row >= (long)first_row && selected_row < (long)last_row)
+            context->renderer->drawRectangle(Rectangle{offset.x,offset.y + row_height * (1 + selected_row - first_row),frozen_width,row_height},selected_color);
+        for(int c = 0; c < frozen; c++)
+            drawColumn(c,column_x[c],offset,last_row,view_height);
+    }
+    for(size_t r = first_row; r <= last_row; r++){
+        float y = offset.y + row_height * (1 + r - first_row);
+        context->renderer->drawLine({offset.x,y},{offset.x + view_width,y},grid_color);
+    }
+    v_scroll->UIDraw();
+    h_scroll->UIDraw();
+}
+
+void DataGrid::Update(){
+    float wheel = context->input->mouseWheelMove();
+    if(wheel != 0)
+        scrollRows((long)(-wheel * 3));
+}
+
+bool DataGrid::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    v_scroll->setBounds({dim.x - 10,0},{10,dim.y - 10});
+    h_scroll->setBounds({0,dim.y - 10},{dim.x - 10,10});
+    invalidate();
+    return true;
+}
+
+void DataGrid::accountMemory(MemoryReport& report){
+    report.addComponent("DataGrid",sizeof(DataGrid));
+    accountStyles(report);
+    report.add(MEMORY_BUFFERS,heapBytes(column_widths) + heapBytes(column_x) + heapBytes(row_order));
+    report.add(MEMORY_STRINGS,heapBytes(cell_buffer));
+    v_scroll->accountMemory(report);
+    h_scroll->accountMemory(report);
+}
+
+bool DataGrid::onClick(Vector2 mouse_pos,MouseButton button){
+    if(v_scroll->Click(mouse_pos,button) || h_scroll->Click(mouse_pos,button))
+        return true;
+    Vector2 offset = getGlobalOffset();
+    Vector2 local = {mouse_pos.x - offset.x,mouse_pos.y - offset.y};
+    if(local.y < row_height){
+        int col = columnAt(local.x);
+        if(col != -1)
+            sortBy(col,sort_column == col ? !sort_ascending : true);
+        return true;
+    }
+    size_t row = first_row + (size_t)((local.y - row_height) / row_height);
+    selected_row = row < source->rowCount() ? (long)row : -1;
+    invalidate();
+    return true;
+}
+
+void DataGrid::onMouseEnter(){
+    startTicking();
+}
+
+void DataGrid::onMouseLeave(){
+    stopTicking();
+}
+
+PlotChannel::PlotChannel(size_t capacity,Color color){
+    int levels = 0;
+    size_t top = 1;
+    while(top * factor * factor <= capacity){
+        top *= factor;
+        levels++;
+    }
+    capacity = (capacity + top - 1) / top * top;
+    samples = vector<float>(capacity);
+    changed = false;
+    mins = vector<vector<float>>(levels + 1);
+    maxs = vector<vector<float>>(levels + 1);
+    for(int k = 1; k <= levels; k++){
+        mins[k] = vector<float>(capacity / blockSize(k));
+        maxs[k] = vector<float>(capacity / blockSize(k));
+    }
+    count = 0;
+    this->color = color;
+}
+
+size_t PlotChannel::blockSize(int level){
+    size_t size = 1;
+    for(int k = 0; k < level; k++)
+        size *= factor;
+    return size;
+}
+
+size_t PlotChannel::oldest(){
+    return count > samples.size() ? count - samples.size() : 0;
+}
+
+int PlotChannel::levelFor(double samples_per_pixel){
+    int level = 0;
+    while(level + 1 < (int)mins.size() && blockSize(level + 1) <= samples_per_pixel)
+        level++;
+    return level;
+}
+
+void PlotChannel::append(float sample){
+    append(&sample,1);
+}
+
+void PlotChannel::append(const float* data,size_t n){
+    lock_guard<mutex> guard(lock);
+    size_t capacity = samples.size();
+    if(n > capacity){
+        data += n - capacity;
+        count += n - capacity;
+        n = capacity;
+    }
+    size_t offset = count % capacity;
+    size_t front = min(n,capacity - offset);
+    memcpy(samples.data() + offset,data,front * sizeof(float));
+    memcpy(samples.data(),data + front,(n - front) * sizeof(float));
+    updateBlocks(count,count + n);
+    count += n;
+    changed = true;
+}
+
+void PlotChannel::updateBlocks(size_t from,size_t to){
+    for(int k = 1; k < (int)mins.size(); k++){
+        size_t size = blockSize(k);
+        size_t blocks = mins[k].size();
+        for(size_t j = max(from / size,(to > samples.size() ? to - samples.size() : 0) / size); (j + 1) * size <= to; j++){
+            if((j + 1) * size <= from)
+                continue;
+            float mn = INFINITY,mx = -INFINITY;
+            if(k == 1){
+                const float* p = samples.data() + (j * size) % samples.size();
+                minMaxKernel(p,p,size,mn,mx);
+            } else {
+                size_t below = (j * factor) % mins[k - 1].size();
+                minMaxKernel(mins[k - 1].data() + below,maxs[k - 1].data() + below,factor,mn,mx);
+            }
+            mins[k][j % blocks] = mn;
+            maxs[k][j % blocks] = mx;
+        }
+    }
+}
+
+void PlotChannel::rawRange(size_t a,size_t b,float& mn,float& mx){
+    if(b <= a)
+        return;
+    size_t capacity = samples.size();
+    size_t offset = a % capacity;
+    size_t front = min(b - a,capacity - offset);
+    minMaxKernel(samples.data() + offset,samples.data() + offset,front,mn,mx);
+    minMaxKernel(samples.data(),samples.data(),b - a - front,mn,mx);
+}
+
+void PlotChannel::range(size_t a,size_t b,int level,float& mn,float& mx){
+    mn = INFINITY;
+    mx = -INFINITY;
+    a = max(a,oldest());
+    if(level == 0){
+        rawRange(a,b,mn,mx);
+        return;
+    }
+    size_t size = blockSize(level);
+    size_t blocks = mins[level].size();
+    size_t first = (a + size - 1) / size;
+    size_t last = b / size;
+    if(last <= first){
+        rawRange(a,b,mn,mx);
+        return;
+    }
+    rawRange(a,first * size,mn,mx);
+    size_t start = first % blocks;
+    size_t n = last - first;
+    size_t front = min(n,blocks - start);
+    minMaxKernel(mins[level].data() + start,maxs[level].data() + start,front,mn,mx);
+    minMaxKernel(mins[level].data(),maxs[level].data(),n - front,mn,mx);
+    rawRange(last * size,b,mn,mx);
+}
+
+Plot::Plot(Vector2 offset,Vector2 dimension,size_t window,float y_min,float y_max):UIComponent(nullptr,offset,dimension){
+    this->window = window;
+    this->y_min = y_min;
+    this->y_max = y_max;
+    auto_scale = false;
+    addStyle(new Background(UIComponent::default_background_color));
+    startTicking();
+}
+
+Plot::~Plot(){
+    for(PlotChannel* c : channels)
+        delete c;
+}
+
+PlotChannel* Plot::addChannel(size_t capacity,Color color){
+    PlotChannel* c = new PlotChannel(max(capacity,window),color);
+    channels.push_back(c);
+    return c;
+}
+
+void Plot::append(int channel,const float* data,size_t n){
+    channels[channel]->append(data,n);
+    invalidate();
+}
+
+void Plot::drawChannel(PlotChannel* channel,Vector2 offset,float lo,float hi){
+    lock_guard<mutex> guard(channel->lock);
+    size_t end = channel->count;
+    size_t view_start = end > window ? end - window : 0;
+    size_t start = max(view_start,channel->oldest());
+    if(end - start < 2 || hi <= lo)
+        return;
+    double spp = (double)window / dimension.x;
+    float scale = dimension.y / (hi - lo);
+    float bottom = offset.y + dimension.y;
+    if(spp <= 1){
+        size_t base = end - min(end,window);
+        float prev_x = offset.x + (start - base) / spp;
+        float prev_y = bottom - (channel->samples[start % channel->samples.size()] - lo) * scale;
+        for(size_t i = start + 1; i < end; i++){
+            float x = offset.x + (i - base) / spp;
+            float y = bottom - (channel->samples[i % channel->samples.size()] - lo) * scale;
+            context->renderer->drawLine({prev_x,prev_y},{x,y},channel->color);
+            prev_x = x;
+            prev_y = y;
+        }
+        return;
+    }
+    int level = channel->levelFor(spp);
+    size_t block = channel->blockSize(level);
+    size_t bin = max((size_t)1,(size_t)(spp / block + .5)) * block;
+    size_t first_bin = view_start / bin * bin;
+    bool has_prev = false;
+    float prev_x = 0,prev_y = 0;
+    for(size_t a = first_bin; a < end; a += bin){
+        size_t b = min(a + bin,end);
+        if(b <= start)
+            continue;
+        float mn,mx;
+        channel->range(max(a,start),b,level,mn,mx);
+        if(mn > mx)
+            continue;
+        float x = offset.x + (float)(((double)a - (double)view_start) / spp);
+        float y_top = bottom - (mx - lo) * scale;
+        float y_bottom = bottom - (mn - lo) * scale;
+        if(has_prev){
+            float y = prev_y < y_top ? y_top : (prev_y > y_bottom ? y_bottom : prev_y);
+            context->renderer->drawLine({prev_x,prev_y},{x,y},channel->color);
+        }
+        context->renderer->drawLine({x,y_top},{x,y_bottom},channel->color);
+        prev_x = x;
+        prev_y = (y_top + y_bottom) / 2;
+        has_prev = true;
+    }
+}
+
+void Plot::Draw(){
+    Vector2 offset = getGlobalOffset();
+    float lo = y_min,hi = y_max;
+    if(auto_scale){
+        lo = INFINITY;
+        hi = -INFINITY;
+        for(PlotChannel* c : channels){
+            lock_guard<mutex> guard(c->lock);
+            size_t start = c->count > window ? c->count - window : 0;
+            float mn,mx;
+            c->range(start,c->count,c->levelFor((c->count - start) / 8.0),mn,mx);
+            lo = min(lo,mn);
+            hi = max(hi,mx);
+        }
+        if(hi <= lo){
+            lo = y_min;
+            hi = y_max;
+        }
+    }
+    for(PlotChannel* c : channels)
+        drawChannel(c,offset,lo,hi);
+}
+
+// Channels can be fed from other threads, so they only flag new samples and
+// the plot invalidates its layer once per frame here.
+void Plot::Update(){
+    bool changed = false;
+    for(PlotChannel* c : channels)
+        changed = c->changed.exchange(false) || changed;
+    if(changed)
+        invalidate();
+}
+
+bool Plot::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    return true;
+}
+
+void Plot::accountMemory(MemoryReport& report){
+    report.addComponent("Plot",sizeof(Plot));
+    accountStyles(report);
+    report.add(MEMORY_BUFFERS,heapBytes(channels));
+    for(PlotChannel* c : channels){
+        report.add(MEMORY_BUFFERS,sizeof(PlotChannel) + heapBytes(c->samples) + heapBytes(c->mins) + heapBytes(c->maxs));
+        for(size_t k = 0; k < c->mins.size(); k++)
+            report.add(MEMORY_BUFFERS,heapBytes(c->mins[k]) + heapBytes(c->maxs[k]));
+    }
+}
+
+TreeDataSource::~TreeDataSource(){}
+
+bool TreeDataSource::hasChildren(size_t node){
+    return childCount(node) > 0;
+}
+
+TreeView::TreeView(Vector2 offset,Vector2 dimension,TreeDataSource* source,float font_size,Color text_color)
+:UIComponent(nullptr,offset,dimension),MouseListener(){
+    size = font_size;
+    row_height = font_size + 4;
+    this->text_color = text_color;
+    root_node = nullptr;
+    select_callback = nullptr;
+    background = new Background(UIComponent::default_background_color);
+    addStyle(background);
+    scroll_bar = new Slider({dimension.x - 10,0},{10,dimension.y},[this](float val){
+        size_t rows = rowCount();
+        size_t visible = visibleRows();
+        first_row = rows > visible ? (size_t)(val * (rows - visible)) : 0;
+        invalidate();
+    });
+    scroll_bar->parent = this;
+    setSource(source);
+    init();
+}
+
+TreeView::~TreeView(){
+    deleteNode(root_node);
+    delete scroll_bar;
+}
+
+void TreeView::deleteNode(TreeNode* node){
+    if(node == nullptr)
+        return;
+    for(auto& c : node->children)
+        deleteNode(c.second);
+    delete node;
+}
+
+void TreeView::setSource(TreeDataSource* source){
+    deleteNode(root_node);
+    this->source = source;
+    size_t id = source->root();
+    size_t count = source->childCount(id);
+    root_node = new TreeNode{id,nullptr,0,-1,count,count,{}};
+    first_row = 0;
+    selected_row = -1;
+    invalidate();
+}
+
+size_t TreeView::rowCount(){
+    return root_node->visible;
+}
+
+TreeRow TreeView::row(size_t index){
+    TreeNode* node = root_node;
+    while(true){
+        size_t skipped = 0;
+        bool descended = false;
+        for(auto& c : node->children){
+            size_t pos = c.first + skipped;
+            if(index < pos)
+                break;
+            if(index == pos)
+                return TreeRow{c.second->id,c.second->depth,node,c.first,c.second};
+            if(index <= pos + c.second->visible){
+                index -= pos + 1;
+                node = c.second;
+                descended = true;
+                break;
+            }
+            skipped += c.second->visible;
+        }
+        if(!descended){
+            size_t child_index = index - skipped;
+            return TreeRow{source->child(node->id,child_index),node->depth + 1,node,child_index,nullptr};
+        }
+    }
+}
+
+void TreeView::addVisible(TreeNode* node,long delta){
+    for(; node != nullptr; node = node->parent)
+        node->visible += delta;
+}
+
+bool TreeView::expand(size_t index){
+    TreeRow r = row(index);
+    if(r.node != nullptr || !source->hasChildren(r.id))
+        return false;
+    size_t count = source->childCount(r.id);
+    TreeNode* node = new TreeNode{r.id,r.parent,r.index,r.depth,count,0,{}};
+    r.parent->children[r.index] = node;
+    node->visible = count;
+    addVisible(r.parent,count);
+    if(selected_row > (long)index)
+        selected_row += count;
+    invalidate();
+    return true;
+}
+
+bool TreeView::collapse(size_t index){
+    TreeRow r = row(index);
+    if(r.node == nullptr)
+        return false;
+    long removed = r.node->visible;
+    addVisible(r.parent,-removed);
+    r.parent->children.erase(r.index);
+    deleteNode(r.node);
+    if(selected_row > (long)index)
+        selected_row = selected_row <= (long)index + removed ? (long)index : selected_row - removed;
+    invalidate();
+    return true;
+}
+
+void TreeView::toggle(size_t index){
+    if(!collapse(index))
+        expand(index);
+}
+
+int TreeView::visibleRows(){
+    return max(1,(int)(dimension.y / row_height));
+}
+
+void TreeView::scrollRows(long delta){
+    size_t rows = rowCount();
+    size_t visible = visibleRows();
+    long bottom = rows > visible ? rows - visible : 0;
+    first_row = max(0L,min(bottom,(long)first_row + delta));
+    scroll_bar->current = bottom > 0 ? (float)first_row / bottom : 0;
+    invalidate();
+}
+
+void TreeView::Draw(){
+    Vector2 offset = getGlobalOffset();
+    size_t rows = rowCount();
+    size_t visible = visibleRows();
+    first_row = min(first_row,rows > visible ? rows - visible : 0);
+    size_t last_row = min(rows,first_row + visible + 1);
+    for(size_t i = first_row; i < last_row; i++){
+        TreeRow r = row(i);
+        float y = offset.y + (i - first_row) * row_height;
+        float x = offset.x + 4 + r.depth * indent;
+        if(selected_row == (long)i)
+            context->renderer->drawRectangle(Rectangle{offset.x,y,dimension.x - scroll_bar->dimension.x,row_height},selected_color);
+        if(r.node != nullptr)
+            context->renderer->drawText("-",{x,y + 2},size,2,text_color);
+        else if(source->hasChildren(r.id))
+            context->renderer->drawText("+",{x,y + 2},size,2,text_color);
+        source->label(r.id,label_buffer);
+        context->renderer->drawText(label_buffer.c_str(),{x + indent,y + 2},size,2,text_color);
+    }
+    scroll_bar->current = rows > visible ? (float)first_row / (rows - visible) : 0;
+    scroll_bar->UIDraw();
+}
+
+void TreeView::Update(){
+    float wheel = context->input->mouseWheelMove();
+    if(wheel != 0)
+        scrollRows((long)(-wheel * 3));
+}
+
+bool TreeView::setBounds(Vector2 off,Vector2 dim){
+    this->offset = off;
+    this->dimension = dim;
+    scroll_bar->setBounds({dim.x - 10,0},{10,dim.y});
+    invalidate();
+    return true;
+}
+
+void TreeView::accountMemory(MemoryReport& report){
+    report.addComponent("TreeView",sizeof(TreeView) - sizeof(select_callback));
+    report.add(MEMORY_CALLBACKS,sizeof(select_callback));
+    accountStyles(report);
+    vector<TreeNode*> pending = {root_node};
+    while(!pending.empty()){
+        TreeNode* node = pending.back();
+        pending.pop_back();
+        report.add(MEMORY_BUFFERS,sizeof(TreeNode) + node->children.size() * (sizeof(pair<size_t,TreeNode*>) + 32));
+        for(auto& c : node->children)
+            pending.push_back(c.second);
+    }
+    report.add(MEMORY_STRINGS,heapBytes(label_buffer));
+    scroll_bar->accountMemory(report);
+}
+
+bool TreeView::onClick(Vector2 mouse_pos,MouseButton button){
+    if(scroll_bar->Click(mouse_pos,button))
+        return true;
+    Vector2 offset = getGlobalOffset();
+    size_t index = first_row + (size_t)((mouse_pos.y - offset.y) / row_height);
+    if(index >= rowCount())
+        return true;
+    TreeRow r = row(index);
+    float expander_x = offset.x + 4 + r.depth * indent;
+    if(mouse_pos.x >= expander_x && mouse_pos.x < expander_x + indent)
+        toggle(index);
+    else {
+        selected_row = index;
+        if(select_callback != nullptr)
+            select_callback(r.id);
+    }
+    invalidate();
+    return true;
+}
+
+void TreeView::onMouseEnter(){
+    startTicking();
+}
+
+void TreeView::onMouseLeave(){
+    stopTicking();
+}
+
+MemoryReport::MemoryReport(){
+    for(int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+        bytes[i] = 0;
+    components = 0;
+    live_components = UIComponent::live_count.load();
+    live_styles = Style::live_count.load();
+    live_timers = Timer::live_count.load();
+    live_bindings = Binding::live_count.load();
+}
+
+void MemoryReport::add(MemoryCategory category,size_t n){
+    bytes[category] += n;
+    type_bytes[current_type] += n;
+}
+
+void MemoryReport::addComponent(const char* type,size_t size){
+    current_type = type;
+    type_counts[current_type]++;
+    components++;
+    add(MEMORY_COMPONENTS,size);
+}
+
+size_t MemoryReport::total(){
+    size_t sum = 0;
+    for(int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+        sum += bytes[i];
+    return sum;
+}
+
+void MemoryReport::print(){
+    cout << "Memory: " << total() << " bytes in " << components << " components" << endl;
+    for(int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+        cout << "  " << category_names[i] << ": " << bytes[i] << endl;
+    for(auto& t : type_bytes)
+        cout << "  " << t.first << " x" << type_counts[t.first] << ": " << t.second << endl;
+    cout << "Live: " << live_components << " components, " << live_styles << " styles, "
+         << live_timers << " timers, " << live_bindings << " bindings" << endl;
+    if(live_components > (long)components)
+        cout << "  " << live_components - (long)components << " components not reachable from this subtree" << endl;
+}
+
+size_t FrameAllocations::total(){
+    size_t n = 0;
+    for(int i = 0; i < PHASE_COUNT; i++)
+        n += count[i];
+    return n;
+}
+
+size_t FrameAllocations::totalBytes(){
+    size_t n = 0;
+    for(int i = 0; i < PHASE_COUNT; i++)
+        n += bytes[i];
+    return n;
+}
+
+AllocationTracker::AllocationTracker(){
+    phase = PHASE_OTHER;
+    in_frame = false;
+    frame = FrameAllocations{};
+    last = FrameAllocations{};
+    frames = 0;
+    allocating_frames = 0;
+    steady_after = -1;
+    for(int i = 0; i < max_sites; i++)
+        sites[i] = AllocationSite{};
+    site_count = 0;
+}
+
+AllocationTracker::~AllocationTracker(){
+    stop();
+}
+
+void AllocationTracker::start(){
+    allocation_tracker = this;
+}
+
+void AllocationTracker::stop(){
+    if(allocation_tracker == this)
+        allocation_tracker = nullptr;
+}
+
+bool AllocationTracker::tracking(){
+    return allocation_tracker == this;
+}
+
+void AllocationTracker::setPhase(FramePhase phase){
+    this->phase = phase;
+}
+
+void AllocationTracker::beginFrame(){
+    frame = FrameAllocations{};
+    if(site_count > 0)
+        for(int i = 0; i < max_sites; i++)
+            sites[i] = AllocationSite{};
+    site_count = 0;
+    phase = PHASE_OTHER;
+    in_frame = true;
+}
+
+void AllocationTracker::endFrame(){
+    if(!in_frame || !tracking())
+        return;
+    in_frame = false;
+    last = frame;
+    frames++;
+    if(last.total() == 0)
+        return;
+    allocating_frames++;
+    if(steady_after >= 0 && (long)frames > steady_after){
+        stop();
+        cout << "Error: " << last.total() << " allocations in steady-state frame " << frames << endl;
+        print();
+        abort();
+    }
+}
+
+void AllocationTracker::requireSteadyState(int warmup_frames){
+    steady_after = frames + warmup_frames;
+}
+
+void AllocationTracker::record(size_t size,void* site){
+    frame.count[phase]++;
+    frame.bytes[phase] += size;
+    if(site == nullptr)
+        return;
+    size_t slot = ((uintptr_t)site >> 2) % max_sites;
+    for(int probe = 0; probe < max_sites; probe++, slot = (slot + 1) % max_sites){
+        AllocationSite& s = sites[slot];
+        if(s.address == nullptr){
+            s.address = site;
+            site_count++;
+        }
+        if(s.address == site){
+            s.count++;
+            s.bytes += size;
+            return;
+        }
+    }
+}
+
+void AllocationTracker::print(){
+    bool was_tracking = tracking();
+    stop();
+    FrameAllocations& f = frame.total() > 0 ? frame : last;
+    cout << "Allocations: " << f.total() << " (" << f.totalBytes() << " bytes), " << f.frees << " frees" << endl;
+    for(int i = 0; i < PHASE_COUNT; i++)
+        cout << "  " << phase_names[i] << ": " << f.count[i] << " (" << f.bytes[i] << " bytes)" << endl;
+    for(int i = 0; i < max_sites; i++)
+        if(sites[i].address != nullptr)
+            cout << "  at " << sites[i].address << ": " << sites[i].count << " (" << sites[i].bytes << " bytes)" << endl;
+    cout << "Frames: " << allocating_frames << " of " << frames << " allocated" << endl;
+    if(was_tracking)
+        start();
+}
+
+MemoryReport measureMemory(UIComponent* root){
+    MemoryReport report;
+    if(root != nullptr)
+        root->accountMemory(report);
+    report.current_type = "Font";
+    report.add(MEMORY_TEXTURES,GetPixelDataSize(context->font.texture.width,context->font.texture.height,context->font.texture.format));
+    report.add(MEMORY_BUFFERS,context->font.glyphCount * (sizeof(GlyphInfo) + sizeof(Rectangle)));
+    report.current_type = "NineSliceCache";
+    report.add(MEMORY_TEXTURES,context->nine_slices.bytes());
+    return report;
+}
+
+Renderer::~Renderer(){}
+
+bool Renderer::cachesLayers(){
+    return false;
+}
+
+// Headless renderers have no window to pace or close.
+void Renderer::setTargetFPS(int){}
+
+void Renderer::close(){}
+
+Texture Renderer::loadTexture(Image image){
+    return LoadTextureFromImage(image);
+}
+
+void Renderer::unloadTexture(Texture texture){
+    UnloadTexture(texture);
+}
+
+// Renderers without offscreen targets return an empty one, and layers on
+// them draw uncached.
+RenderTexture Renderer::loadRenderTarget(int,int){
+    return RenderTexture{};
+}
+
+void Renderer::unloadRenderTarget(RenderTexture){}
+
+void Renderer::beginRenderTarget(RenderTexture,Color){}
+
+void Renderer::endRenderTarget(){}
+
+// Corners are copied 1:1 (or squashed when dest is smaller than two corners);
+// the single middle row and column of the source are stretched.
+void Renderer::drawNinePatch(Texture texture,int corner,Rectangle dest,Color tint){
+    float cx = min((float)corner,dest.width / 2);
+    float cy = min((float)corner,dest.height / 2);
+    float sx[4] = {0,(float)corner,(float)(texture.width - corner),(float)texture.width};
+    float sy[4] = {0,(float)corner,(float)(texture.height - corner),(float)texture.height};
+    float dx[4] = {dest.x,dest.x + cx,dest.x + dest.width - cx,dest.x + dest.width};
+    float dy[4] = {dest.y,dest.y + cy,dest.y + dest.height - cy,dest.y + dest.height};
+    for(int j = 0; j < 3; j++){
+        for(int i = 0; i < 3; i++){
+            Rectangle to = {dx[i],dy[j],dx[i + 1] - dx[i],dy[j + 1] - dy[j]};
+            if(to.width > 0 && to.height > 0)
+                drawTexture(texture,Rectangle{sx[i],sy[j],sx[i + 1] - sx[i],sy[j + 1] - sy[j]},to,tint);
+        }
+    }
+}
+
+void RaylibRenderer::beginFrame(Color clear){
+    BeginDrawing();
+    ClearBackground(clear);
+}
+
+void RaylibRenderer::endFrame(){
+    EndDrawing();
+}
+
+void RaylibRenderer::beginScissor(Rectangle r){
+    BeginScissorMode((int)r.x,(int)r.y,(int)r.width,(int)r.height);
+}
+
+void RaylibRenderer::endScissor(){
+    EndScissorMode();
+}
+
+void RaylibRenderer::drawRectangle(Rectangle r,Color color){
+    DrawRectangle((int)r.x,(int)r.y,(int)r.width,(int)r.height,color);
+}
+
+void RaylibRenderer::drawLine(Vector2 from,Vector2 to,Color color){
+    DrawLineV(from,to,color);
+}
+
+void RaylibRenderer::drawTexture(Texture texture,Rectangle source,Rectangle dest,Color tint){
+    DrawTexturePro(texture,source,dest,Vector2{0,0},0,tint);
+}
+
+void RaylibRenderer::drawText(const char* text,Vector2 position,float font_size,float spacing,Color color){
+    DrawTextEx(context->font,text,position,font_size,spacing,color);
+}
+
+void RaylibRenderer::drawNinePatch(Texture texture,int corner,Rectangle dest,Color tint){
+    NPatchInfo info = {Rectangle{0,0,(float)texture.width,(float)texture.height},corner,corner,corner,corner,NPATCH_NINE_PATCH};
+    DrawTextureNPatch(texture,info,dest,Vector2{0,0},0,tint);
+}
+
+RenderTexture RaylibRenderer::loadRenderTarget(int width,int height){
+    return LoadRenderTexture(width,height);
+}
+
+void RaylibRenderer::unloadRenderTarget(RenderTexture target){
+    UnloadRenderTexture(target);
+}
+
+void RaylibRenderer::beginRenderTarget(RenderTexture target,Color clear){
+    BeginTextureMode(target);
+    ClearBackground(clear);
+}
+
+void RaylibRenderer::endRenderTarget(){
+    EndTextureMode();
+}
+
+bool RaylibRenderer::cachesLayers(){
+    return true;
+}
+
+void RaylibRenderer::setTargetFPS(int fps){
+    SetTargetFPS(fps);
+}
+
+void RaylibRenderer::close(){
+    CloseWindow();
+}
+
+bool NineSliceKey::operator<(const NineSliceKey& other) const{
+    return tie(renderer,radius,thickness,blur) < tie(other.renderer,other.radius,other.thickness,other.blur);
+}
+
+// Coverage of a pixel whose center is signed distance d outside the shape
+// edge: a one pixel antialiasing ramp, or a gaussian falloff when blurred.
+static float edgeCoverage(float d,float sigma){
+    if(sigma <= 0)
+        return min(max(0.5f - d,0.0f),1.0f);
+    return 0.5f * erfc(d / (sigma * sqrt(2.0f)));
+}
+
+NineSlice& NineSliceCache::get(int radius,int thickness,int blur){
+    NineSliceKey key = {context->renderer,radius,thickness,blur};
+    auto it = slices.find(key);
+    if(it != slices.end())
+        return it->second;
+    NineSlice slice;
+    float sigma = blur / 2.0f;
+    slice.inset = (int)ceil(3 * sigma);
+    slice.corner = 2 * slice.inset + max(radius,thickness) + 1;
+    int size = 2 * slice.corner + 1;
+    float center = size / 2.0f;
+    float half = center - slice.inset;
+    Image image = GenImageColor(size,size,BLANK);
+    Color* texels = (Color*)image.data;
+    for(int y = 0; y < size; y++){
+        for(int x = 0; x < size; x++){
+            float qx = fabs(x + 0.5f - center) - (half - radius);
+            float qy = fabs(y + 0.5f - center) - (half - radius);
+            float outside = sqrt(max(qx,0.0f) * max(qx,0.0f) + max(qy,0.0f) * max(qy,0.0f));
+            float d = outside + min(max(qx,qy),0.0f) - radius;
+            float alpha = edgeCoverage(d,sigma);
+            if(thickness > 0)
+                alpha -= edgeCoverage(d + thickness,sigma);
+            texels[y * size + x] = Color{255,255,255,(unsigned char)lround(max(alpha,0.0f) * 255)};
+        }
+    }
+    slice.texture = context->renderer->loadTexture(image);
+    UnloadImage(image);
+    return slices[key] = slice;
+}
+
+void NineSliceCache::draw(Rectangle shape,int radius,int thickness,int blur,Color tint){
+    NineSlice& slice = get(radius,thickness,blur);
+    Rectangle dest = {shape.x - slice.inset,shape.y - slice.inset,shape.width + 2 * slice.inset,shape.height + 2 * slice.inset};
+    context->renderer->drawNinePatch(slice.texture,slice.corner,dest,tint);
+}
+
+void NineSliceCache::clear(){
+    for(auto& s : slices)
+        s.first.renderer->unloadTexture(s.second.texture);
+    slices.clear();
+}
+
+size_t NineSliceCache::bytes(){
+    size_t total = 0;
+    for(auto& s : slices)
+        total += (size_t)s.second.texture.width * s.second.texture.height * 4;
+    return total;
+}
+
+static inline void blendPixel(Color& dst,Color src){
+    if(src.a == 255){
+        dst = src;
+        return;
+    }
+    if(src.a == 0)
+        return;
+    int a = src.a;
+    int ia = 255 - a;
+    dst.r = (unsigned char)((src.r * a + dst.r * ia + 127) / 255);
+    dst.g = (unsigned char)((src.g * a + dst.g * ia + 127) / 255);
+    dst.b = (unsigned char)((src.b * a + dst.b * ia + 127) / 255);
+    dst.a = (unsigned char)(a + (dst.a * ia + 127) / 255);
+}
+
+static inline Color tintTexel(Color texel,Color tint){
+    return Color{(unsigned char)((texel.r * tint.r + 127) / 255),(unsigned char)((texel.g * tint.g + 127) / 255),
+                 (unsigned char)((texel.b * tint.b + 127) / 255),(unsigned char)((texel.a * tint.a + 127) / 255)};
+}
+
+SoftwareRenderer::SoftwareRenderer(int width,int height,int threads){
+    this->threads = threads > 0 ? threads : max(1,(int)thread::hardware_concurrency());
+    clear_color = WHITE;
+    next_texture_id = texture_id_base;
+    atlas.width = 0;
+    atlas.height = 0;
+    stats = RenderStats{0,0,0,0,0,0,0};
+    pool_generation = 0;
+    pool_busy = 0;
+    pool_stop = false;
+    resize(width,height);
+}
+
+SoftwareRenderer::~SoftwareRenderer(){
+    {
+        lock_guard<mutex> guard(pool_lock);
+        pool_stop = true;
+    }
+    pool_wake.notify_all();
+    for(thread& t : pool)
+        t.join();
+}
+
+void SoftwareRenderer::resize(int width,int height){
+    this->width = width;
+    this->height = height;
+    pixels.assign((size_t)width * height,clear_color);
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int tiles_y = (height + tile_size - 1) / tile_size;
+    bins.assign(tiles_x * tiles_y,vector<int>());
+    clip = Rectangle{0,0,(float)width,(float)height};
+}
+
+static void loadTexels(SoftwareTexture& texture,Image image){
+    Color* colors = LoadImageColors(image);
+    texture.texels.assign(colors,colors + (size_t)image.width * image.height);
+    texture.width = image.width;
+    texture.height = image.height;
+    UnloadImageColors(colors);
+}
+
+Texture SoftwareRenderer::loadTexture(Image image){
+    Texture texture = {next_texture_id++,image.width,image.height,1,PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    loadTexels(textures[texture.id],image);
+    return texture;
+}
+
+void SoftwareRenderer::unloadTexture(Texture texture){
+    textures.erase(texture.id);
+}
+
+void SoftwareRenderer::setFontAtlas(Image image){
+    loadTexels(atlas,image);
+}
+
+Font SoftwareRenderer::loadFont(const char* file_name,int font_size,int glyph_count){
+    Font f = {};
+    unsigned int size = 0;
+    unsigned char* data = LoadFileData(file_name,&size);
+    if(data == nullptr)
+        return f;
+    f.baseSize = font_size;
+    f.glyphCount = glyph_count;
+    f.glyphPadding = 4;
+    f.glyphs = LoadFontData(data,size,font_size,nullptr,glyph_count,FONT_DEFAULT);
+    UnloadFileData(data);
+    if(f.glyphs == nullptr)
+        return f;
+    Image image = GenImageFontAtlas(f.glyphs,&f.recs,glyph_count,font_size,f.glyphPadding,0);
+    setFontAtlas(image);
+    UnloadImage(image);
+    return f;
+}
+
+Image SoftwareRenderer::frame(){
+    return Image{pixels.data(),width,height,1,PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+}
+
+bool SoftwareRenderer::exportPNG(const char* file_name){
+    return ExportImage(frame(),file_name);
+}
+
+void SoftwareRenderer::beginFrame(Color clear){
+    frame_start = chrono::steady_clock::now();
+    clear_color = clear;
+    commands.clear();
+    clip = Rectangle{0,0,(float)width,(float)height};
+}
+
+void SoftwareRenderer::beginScissor(Rectangle r){
+    float x = max(r.x,0.0f);
+    float y = max(r.y,0.0f);
+    clip = Rectangle{x,y,min(r.x + r.width,(float)width) - x,min(r.y + r.height,(float)height) - y};
+}
+
+void SoftwareRenderer::endScissor(){
+    clip = Rectangle{0,0,(float)width,(float)height};
+}
+
+void SoftwareRenderer::push(RasterCommand command,Rectangle bounds){
+    command.x0 = max((int)bounds.x,(int)clip.x);
+    command.y0 = max((int)bounds.y,(int)clip.y);
+    command.x1 = min((int)(bounds.x + bounds.width),(int)(clip.x + clip.width));
+    command.y1 = min((int)(bounds.y + bounds.height),(int)(clip.y + clip.height));
+    if(command.x0 >= command.x1 || command.y0 >= command.y1 || command.color.a == 0)
+        return;
+    commands.push_back(command);
+}
+
+void SoftwareRenderer::drawRectangle(Rectangle r,Color color){
+    RasterCommand command = {RASTER_RECTANGLE,r,Rectangle{},color,nullptr,0,0};
+    push(command,Rectangle{(float)(int)r.x,(float)(int)r.y,(float)(int)r.width,(float)(int)r.height});
+}
+
+void SoftwareRenderer::drawLine(Vector2 from,Vector2 to,Color color){
+    RasterCommand command = {RASTER_LINE,Rectangle{from.x,from.y,to.x - from.x,to.y - from.y},Rectangle{},color,nullptr,0,0};
+    float x = floor(min(from.x,to.x));
+    float y = floor(min(from.y,to.y));
+    push(command,Rectangle{x,y,floor(max(from.x,to.x)) - x + 1,floor(max(from.y,to.y)) - y + 1});
+}
+
+void SoftwareRenderer::drawTexture(Texture texture,Rectangle source,Rectangle dest,Color tint){
+    if(texture.id < texture_id_base)
+        return;
+    auto it = textures.find(texture.id);
+    if(it == textures.end() || dest.width <= 0 || dest.height <= 0)
+        return;
+    SoftwareTexture& t = it->second;
+    RasterCommand command = {RASTER_TEXTURE,dest,source,tint,t.texels.data(),t.width,t.height};
+    float x = ceil(dest.x - 0.5f);
+    float y = ceil(dest.y - 0.5f);
+    push(command,Rectangle{x,y,ceil(dest.x + dest.width - 0.5f) - x,ceil(dest.y + dest.height - 0.5f) - y});
+}
+
+void SoftwareRenderer::drawText(const char* text,Vector2 position,float font_size,float spacing,Color color){
+    if(atlas.texels.empty())
+        return;
+    float scale = font_size / context->font.baseSize;
+    float padding = context->font.glyphPadding;
+    float x = 0;
+    float y = 0;
+    for(const char* p = text; *p != '\0'; p++){
+        int codepoint = (unsigned char)*p;
+        if(codepoint == '\n'){
+            x = 0;
+            y += (context->font.baseSize + context->font.baseSize / 2) * scale;
+            continue;
+        }
+        if(codepoint != ' ' && codepoint != '\t'){
+            int index = GetGlyphIndex(context->font,codepoint);
+            Rectangle rec = context->font.recs[index];
+            Rectangle source = {rec.x - padding,rec.y - padding,rec.width + 2 * padding,rec.height + 2 * padding};
+            Rectangle dest = {position.x + x + (context->font.glyphs[index].offsetX - padding) * scale,
+                              position.y + y + (context->font.glyphs[index].offsetY - padding) * scale,
+                              source.width * scale,source.height * scale};
+            RasterCommand command = {RASTER_TEXTURE,dest,source,color,atlas.texels.data(),atlas.width,atlas.height};
+            float left = ceil(dest.x - 0.5f);
+            float top = ceil(dest.y - 0.5f);
+            push(command,Rectangle{left,top,ceil(dest.x + dest.width - 0.5f) - left,ceil(dest.y + dest.height - 0.5f) - top});
+        }
+        x += glyphAdvance(codepoint,font_size,spacing);
+    }
+}
+
+void SoftwareRenderer::rasterizeTiles(){
+    int tiles = (int)bins.size();
+    for(int tile = next_tile++; tile < tiles; tile = next_tile++)
+        rasterizeTile(tile);
+}
+
+void SoftwareRenderer::poolWorker(){
+    long seen = 0;
+    unique_lock<mutex> lock(pool_lock);
+    while(true){
+        pool_wake.wait(lock,[this,&seen](){ return pool_stop || pool_generation != seen; });
+        if(pool_stop)
+            return;
+        seen = pool_generation;
+        lock.unlock();
+        rasterizeTiles();
+        lock.lock();
+        if(--pool_busy == 0)
+            pool_idle.notify_one();
+    }
+}
+
+void SoftwareRenderer::rasterizeTile(int tile){
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int tx0 = (tile % tiles_x) * tile_size;
+    int ty0 = (tile / tiles_x) * tile_size;
+    int tx1 = min(tx0 + tile_size,width);
+    int ty1 = min(ty0 + tile_size,height);
+    for(int y = ty0; y < ty1; y++)
+        fill(pixels.begin() + (size_t)y * width + tx0,pixels.begin() + (size_t)y * width + tx1,clear_color);
+    for(int i : bins[tile]){
+        RasterCommand& c = commands[i];
+        int x0 = max(c.x0,tx0);
+        int y0 = max(c.y0,ty0);
+        int x1 = min(c.x1,tx1);
+        int y1 = min(c.y1,ty1);
+        if(x0 >= x1 || y0 >= y1)
+            continue;
+        if(c.type == RASTER_RECTANGLE){
+            for(int y = y0; y < y1; y++){
+                Color* row = &pixels[(size_t)y * width];
+                for(int x = x0; x < x1; x++)
+                    blendPixel(row[x],c.color);
+            }
+        } else if(c.type == RASTER_LINE){
+            float dx = c.dest.width;
+            float dy = c.dest.height;
+            int steps = max(1,(int)ceil(max(fabs(dx),fabs(dy))));
+            int last_x = INT32_MIN;
+            int last_y = INT32_MIN;
+            for(int s = 0; s <= steps; s++){
+                int x = (int)floor(c.dest.x + dx * s / steps);
+                int y = (int)floor(c.dest.y + dy * s / steps);
+                if(x == last_x && y == last_y)
+                    continue;
+                last_x = x;
+                last_y = y;
+                if(x >= x0 && x < x1 && y >= y0 && y < y1)
+                    blendPixel(pixels[(size_t)y * width + x],c.color);
+            }
+        } else {
+            float su = c.source.width / c.dest.width;
+            float sv = fabs(c.source.height) / c.dest.height;
+            bool flip = c.source.height < 0;
+            for(int y = y0; y < y1; y++){
+                float t = (y + 0.5f - c.dest.y) * sv;
+                int v = (int)(flip ? c.source.y - c.source.height - t : c.source.y + t);
+                v = min(max(v,0),c.texels_height - 1);
+                const Color* texels = c.texels + (size_t)v * c.texels_width;
+                Color* row = &pixels[(size_t)y * width];
+                for(int x = x0; x < x1; x++){
+                    int u = (int)(c.source.x + (x + 0.5f - c.dest.x) * su);
+                    u = min(max(u,0),c.texels_width - 1);
+                    blendPixel(row[x],tintTexel(texels[u],c.color));
+                }
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::endFrame(){
+    chrono::steady_clock::time_point record_end = chrono::steady_clock::now();
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    for(vector<int>& bin : bins)
+        bin.clear();
+    long covered = 0;
+    for(int i = 0; i < (int)commands.size(); i++){
+        RasterCommand& c = commands[i];
+        covered += (long)(c.x1 - c.x0) * (c.y1 - c.y0);
+        for(int ty = c.y0 / tile_size; ty <= (c.y1 - 1) / tile_size; ty++)
+            for(int tx = c.x0 / tile_size; tx <= (c.x1 - 1) / tile_size; tx++)
+                bins[ty * tiles_x + tx].push_back(i);
+    }
+    chrono::steady_clock::time_point bin_end = chrono::steady_clock::now();
+    int tiles = (int)bins.size();
+    int workers_count = covered < parallel_pixels ? 1 : min(threads,tiles);
+    next_tile = 0;
+    if(workers_count > 1){
+        unique_lock<mutex> lock(pool_lock);
+        while((int)pool.size() < threads - 1)
+            pool.emplace_back(&SoftwareRenderer::poolWorker,this);
+        pool_busy = (int)pool.size();
+        pool_generation++;
+        lock.unlock();
+        pool_wake.notify_all();
+        rasterizeTiles();
+        lock.lock();
+        pool_idle.wait(lock,[this](){ return pool_busy == 0; });
+    } else
+        rasterizeTiles();
+    chrono::steady_clock::time_point raster_end = chrono::steady_clock::now();
+    stats.record_ms = chrono::duration<double,milli>(record_end - frame_start).count();
+    stats.bin_ms = chrono::duration<double,milli>(bin_end - record_end).count();
+    stats.raster_ms = chrono::duration<double,milli>(raster_end - bin_end).count();
+    stats.total_ms = chrono::duration<double,milli>(raster_end - frame_start).count();
+    stats.commands = commands.size();
+    stats.tiles = tiles;
+    stats.threads = workers_count > 1 ? (int)pool.size() + 1 : 1;
+}
+
+InputSource::~InputSource(){}
+
+// Fetches events that arrived since poll() without starting a new frame.
+// Sources that replay or record frames leave this empty so late sampling
+// cannot change what gets replayed.
+void InputSource::latch(){}
+
+// Blocks for up to seconds and returns true if input arrived meanwhile.
+// Recorded and scripted sources have nothing to wait for, so they return at
+// once as if input arrived and run as fast as possible.
+bool InputSource::wait(double){
+    return true;
+}
+
+RaylibInput::RaylibInput(){
+    for(int b = 0; b < 3; b++)
+        latched[b] = pending[b] = false;
+    latched_wheel = pending_wheel = 0;
+    next_key = 0;
+}
+
+// Edges raylib reports after the extra poll in latch() would be overwritten
+// by the next poll, so they are held here and reported with the next frame.
+void RaylibInput::poll(){
+    for(int b = 0; b < 3; b++){
+        pending[b] = latched[b];
+        latched[b] = false;
+    }
+    pending_wheel = latched_wheel;
+    latched_wheel = 0;
+    pending_keys.swap(latched_keys);
+    latched_keys.clear();
+    next_key = 0;
+}
+
+// Events are fetched through latch() so edges seen while waiting reach the
+// next frame.
+bool RaylibInput::wait(double seconds){
+    Vector2 mouse = GetMousePosition();
+    size_t keys = latched_keys.size();
+    float wheel = latched_wheel;
+    if(seconds > 0)
+        WaitTime(seconds);
+    latch();
+    Vector2 moved = GetMousePosition();
+    bool arrived = moved.x != mouse.x || moved.y != mouse.y || latched_keys.size() != keys || latched_wheel != wheel || IsWindowResized();
+    for(int b = 0; b < 3; b++)
+        arrived = arrived || latched[b] || IsMouseButtonDown(b);
+    return arrived;
+}
+
+void RaylibInput::latch(){
+    PollInputEvents();
+    for(int b = 0; b < 3; b++)
+        latched[b] = latched[b] || IsMouseButtonPressed(b);
+    latched_wheel += GetMouseWheelMove();
+    for(int key = GetKeyPressed(); key != 0; key = GetKeyPressed())
+        latched_keys.push_back(key);
+}
+
+bool RaylibInput::done(){
+    return WindowShouldClose();
+}
+
+double RaylibInput::time(){
+    return GetTime();
+}
+
+Vector2 RaylibInput::mousePosition(){
+    return GetMousePosition();
+}
+
+bool RaylibInput::isMouseButtonPressed(int button){
+    if(button >= 0 && button < 3 && pending[button]){
+        pending[button] = false;
+        return true;
+    }
+    return IsMouseButtonPressed(button);
+}
+
+bool RaylibInput::isMouseButtonDown(int button){
+    return IsMouseButtonDown(button);
+}
+
+float RaylibInput::mouseWheelMove(){
+    return pending_wheel + GetMouseWheelMove();
+}
+
+int RaylibInput::keyPressed(){
+    if(next_key < pending_keys.size())
+        return pending_keys[next_key++];
+    return GetKeyPressed();
+}
+
+bool RaylibInput::isKeyDown(int key){
+    return IsKeyDown(key);
+}
+
+InputFrameSource::InputFrameSource(){
+    frame.time = 0;
+    frame.mouse = {0,0};
+    frame.buttons = 0;
+    frame.wheel = 0;
+    frame.next_key = 0;
+}
+
+double InputFrameSource::time(){
+    return frame.time;
+}
+
+Vector2 InputFrameSource::mousePosition(){
+    return frame.mouse;
+}
+
+bool InputFrameSource::isMouseButtonPressed(int button){
+    return button >= 0 && button < 3 && (frame.buttons & (1 << button));
+}
+
+bool InputFrameSource::isMouseButtonDown(int button){
+    return button >= 0 && button < 3 && (frame.buttons & (16 << button));
+}
+
+float InputFrameSource::mouseWheelMove(){
+    return frame.wheel;
+}
+
+int InputFrameSource::keyPressed(){
+    if(frame.next_key >= frame.keys.size())
+        return 0;
+    return frame.keys[frame.next_key++];
+}
+
+bool InputFrameSource::isKeyDown(int key){
+    return find(frame.down.begin(),frame.down.end(),key) != frame.down.end();
+}
+
+enum InputFrameFlags{
+    INPUT_MOUSE = 1,
+    INPUT_BUTTONS = 2,
+    INPUT_WHEEL = 4,
+    INPUT_KEYS = 8,
+    INPUT_DOWN = 16,
+};
+
+static const char input_magic[4] = {'U','I','R','C'};
+
+InputRecorder::InputRecorder(const char* file_name,InputSource* source){
+    this->source = source;
+    frames = 0;
+    start_time = -1;
+    last_time = 0;
+    file = fopen(file_name,"wb");
+    if(file != nullptr)
+        fwrite(input_magic,1,4,file);
+}
+
+InputRecorder::~InputRecorder(){
+    if(file != nullptr)
+        fclose(file);
+}
+
+bool InputRecorder::isOpen(){
+    return file != nullptr;
+}
+
+template<class T>
+void InputRecorder::put(T value){
+    fwrite(&value,sizeof(T),1,file);
+}
+
+void InputRecorder::poll(){
+    source->poll();
+    InputFrame next;
+    next.time = source->time();
+    if(start_time < 0)
+        start_time = next.time;
+    next.mouse = source->mousePosition();
+    next.buttons = 0;
+    for(int b = 0; b < 3; b++){
+        if(source->isMouseButtonPressed(b))
+            next.buttons |= 1 << b;
+        if(source->isMouseButtonDown(b))
+            next.buttons |= 16 << b;
+    }
+    next.wheel = source->mouseWheelMove();
+    for(int key = source->keyPressed(); key != 0; key = source->keyPressed())
+        next.keys.push_back(key);
+    for(int key = 1; key < 512; key++)
+        if(source->isKeyDown(key))
+            next.down.push_back(key);
+    next.next_key = 0;
+    if(file != nullptr){
+        unsigned char flags = 0;
+        if(frames == 0 || next.mouse.x != frame.mouse.x || next.mouse.y != frame.mouse.y)
+            flags |= INPUT_MOUSE;
+        if(frames == 0 || next.buttons != frame.buttons)
+            flags |= INPUT_BUTTONS;
+        if(next.wheel != 0)
+            flags |= INPUT_WHEEL;
+        if(!next.keys.empty())
+            flags |= INPUT_KEYS;
+        if(next.down != frame.down)
+            flags |= INPUT_DOWN;
+        double t = next.time - start_time;
+        put<float>((float)(t - last_time));
+        last_time += (float)(t - last_time);
+        put<unsigned char>(flags);
+        if(flags & INPUT_MOUSE){
+            put<float>(next.mouse.x);
+            put<float>(next.mouse.y);
+        }
+        if(flags & INPUT_BUTTONS)
+            put<unsigned char>(next.buttons);
+        if(flags & INPUT_WHEEL)
+            put<float>(next.wheel);
+        if(flags & INPUT_KEYS){
+            put<unsigned char>((unsigned char)min(next.keys.size(),(size_t)255));
+            for(size_t i = 0; i < next.keys.size() && i < 255; i++)
+                put<unsigned short>((unsigned short)next.keys[i]);
+        }
+        if(flags & INPUT_DOWN){
+            put<unsigned char>((unsigned char)min(next.down.size(),(size_t)255));
+            for(size_t i = 0; i < next.down.size() && i < 255; i++)
+                put<unsigned short>((unsigned short)next.down[i]);
+        }
+    }
+    frame = next;
+    frames++;
+}
+
+// The source fetches and buffers events as usual; they are recorded with
+// the next poll(), while this frame keeps reporting what was recorded so a
+// replay sees the same values.
+void InputRecorder::latch(){
+    source->latch();
+}
+
+bool InputRecorder::wait(double seconds){
+    return source->wait(seconds);
+}
+
+bool InputRecorder::done(){
+    return source->done();
+}
+
+InputReplay::InputReplay(const char* file_name){
+    frames = 0;
+    pos = 0;
+    FILE* file = fopen(file_name,"rb");
+    if(file == nullptr)
+        return;
+    unsigned char chunk[4096];
+    for(size_t n = fread(chunk,1,sizeof(chunk),file); n > 0; n = fread(chunk,1,sizeof(chunk),file))
+        data.insert(data.end(),chunk,chunk + n);
+    fclose(file);
+    if(data.size() < 4 || memcmp(data.data(),input_magic,4) != 0)
+        data.clear();
+    else
+        pos = 4;
+}
+
+bool InputReplay::isLoaded(){
+    return !data.empty();
+}
+
+template<class T>
+T InputReplay::get(){
+    T value;
+    if(pos + sizeof(T) > data.size()){
+        pos = data.size();
+        return T();
+    }
+    memcpy(&value,&data[pos],sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+void InputReplay::poll(){
+    if(done())
+        return;
+    frame.time += get<float>();
+    unsigned char flags = get<unsigned char>();
+    if(flags & INPUT_MOUSE){
+        frame.mouse.x = get<float>();
+        frame.mouse.y = get<float>();
+    }
+    if(flags & INPUT_BUTTONS)
+        frame.buttons = get<unsigned char>();
+    frame.wheel = (flags & INPUT_WHEEL) ? get<float>() : 0;
+    frame.keys.clear();
+    frame.next_key = 0;
+    if(flags & INPUT_KEYS){
+        int n = get<unsigned char>();
+        for(int i = 0; i < n; i++)
+            frame.keys.push_back(get<unsigned short>());
+    }
+    if(flags & INPUT_DOWN){
+        frame.down.clear();
+        int n = get<unsigned char>();
+        for(int i = 0; i < n; i++)
+            frame.down.push_back(get<unsigned short>());
+    }
+    frames++;
+}
+
+bool InputReplay::done(){
+    return pos >= data.size();
+}
+
+double ReplayReport::percentile(bool render,double p){
+    if(frames.empty())
+        return 0;
+    vector<double> times;
+    for(FrameTiming& f : frames)
+        times.push_back(render ? f.render_ms : f.update_ms);
+    size_t k = min(times.size() - 1,(size_t)(p / 100 * times.size()));
+    nth_element(times.begin(),times.begin() + k,times.end());
+    return times[k];
+}
+
+void ReplayReport::print(){
+    cout << "Replay: " << frames.size() << " frames in " << total_ms << " ms" << endl;
+    const char* names[2] = {"update","render"};
+    for(int r = 0; r < 2; r++){
+        double sum = 0;
+        for(FrameTiming& f : frames)
+            sum += r ? f.render_ms : f.update_ms;
+        cout << "  " << names[r] << ": mean " << (frames.empty() ? 0 : sum / frames.size())
+             << " p50 " << percentile(r,50) << " p95 " << percentile(r,95)
+             << " p99 " << percentile(r,99) << " max " << percentile(r,100) << " ms" << endl;
+    }
+}
+
+bool ReplayReport::exportCSV(const char* file_name){
+    FILE* file = fopen(file_name,"w");
+    if(file == nullptr)
+        return false;
+    fprintf(file,"frame,update_ms,render_ms\n");
+    for(size_t i = 0; i < frames.size(); i++)
+        fprintf(file,"%zu,%.4f,%.4f\n",i,frames[i].update_ms,frames[i].render_ms);
+    fclose(file);
+    return true;
+}
+
+ReplayReport replayInput(const char* file_name){
+    ReplayReport report;
+    report.total_ms = 0;
+    InputReplay replay(file_name);
+    if(!replay.isLoaded())
+        return report;
+    InputSource* saved_input = context->input;
+    bool saved_fixed_step = context->loop.fixed_step;
+    context->input = &replay;
+    context->loop.fixed_step = false;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while(!replay.done()){
+        context->loop.pollInput();
+        context->loop.update(replay.time());
+        context->loop.render(replay.time());
+        report.frames.push_back(FrameTiming{context->loop.update_ms,context->loop.render_ms});
+    }
+    report.total_ms = chrono::duration<double,milli>(chrono::steady_clock::now() - start).count();
+    context->input = saved_input;
+    context->loop.fixed_step = saved_fixed_step;
+    return report;
+}
+
+static const char asset_magic[4] = {'U','I','A','P'};
+static const uint32_t asset_version = 1;
+static const size_t asset_header_size = 16;
+
+static size_t imageDataSize(Image image){
+    size_t size = 0;
+    int width = image.width;
+    int height = image.height;
+    for(int level = 0; level < max(image.mipmaps,1); level++){
+        size += GetPixelDataSize(width,height,image.format);
+        width = max(width / 2,1);
+        height = max(height / 2,1);
+    }
+    return size;
+}
+
+// Checks an entry read from disk. Ranges are compared by subtraction so
+// corrupt offsets cannot wrap, and the pixel range must hold every mip level
+// the header claims before raylib is handed a view of it.
+static bool entryInBounds(const AssetEntry& e,uint64_t length){
+    if(e.width <= 0 || e.height <= 0 || e.mipmaps < 1 || e.mipmaps > 32 || e.glyph_count < 0)
+        return false;
+    // GetPixelDataSize works in int; 16 bytes is the widest pixel format.
+    if((uint64_t)e.width * e.height > INT_MAX / 16)
+        return false;
+    size_t needed = imageDataSize(Image{nullptr,e.width,e.height,e.mipmaps,e.format});
+    if(needed == 0 || e.pixels_size < needed)
+        return false;
+    if(e.pixels > length || e.pixels_size > length - e.pixels)
+        return false;
+    uint64_t glyph_bytes = (uint64_t)e.glyph_count * sizeof(PackedGlyph);
+    return e.glyphs <= length && glyph_bytes <= length - e.glyphs;
+}
+
+AssetPackBuilder::PendingAsset* AssetPackBuilder::add(const char* name,AssetType type,Image image){
+    if(image.data == nullptr || strlen(name) >= sizeof(AssetEntry::name)){
+        cout << "Error: Asset " << name << " could not be packed" << endl;
+        return nullptr;
+    }
+    assets.push_back(PendingAsset{});
+    PendingAsset& asset = assets.back();
+    strncpy(asset.entry.name,name,sizeof(asset.entry.name) - 1);
+    asset.entry.type = type;
+    asset.entry.format = image.format;
+    asset.entry.width = image.width;
+    asset.entry.height = image.height;
+    asset.entry.mipmaps = max(image.mipmaps,1);
+    const unsigned char* pixels = (const unsigned char*)image.data;
+    asset.pixels.assign(pixels,pixels + imageDataSize(image));
+    return &asset;
+}
+
+bool AssetPackBuilder::addFont(const char* name,Font font,Image atlas){
+    if(font.glyphs == nullptr || font.recs == nullptr)
+        return false;
+    PendingAsset* asset = add(name,ASSET_FONT,atlas);
+    if(asset == nullptr)
+        return false;
+    asset->entry.base_size = font.baseSize;
+    asset->entry.glyph_count = font.glyphCount;
+    asset->entry.glyph_padding = font.glyphPadding;
+    for(int i = 0; i < font.glyphCount; i++){
+        GlyphInfo& g = font.glyphs[i];
+        asset->glyphs.push_back(PackedGlyph{g.value,g.offsetX,g.offsetY,g.advanceX,font.recs[i]});
+    }
+    return true;
+}
+
+bool AssetPackBuilder::addFont(const char* name,const char* file_name,int font_size,int glyph_count){
+    unsigned int size = 0;
+    unsigned char* data = LoadFileData(file_name,&size);
+    if(data == nullptr){
+        cout << "Error: Font " << file_name << " could not be read" << endl;
+        return false;
+    }
+    Font font = {};
+    font.baseSize = font_size;
+    font.glyphCount = glyph_count;
+    font.glyphPadding = 4;
+    font.glyphs = LoadFontData(data,size,font_size,nullptr,glyph_count,FONT_DEFAULT);
+    UnloadFileData(data);
+    if(font.glyphs == nullptr){
+        cout << "Error: Font " << file_name << " could not be rasterized" << endl;
+        return false;
+    }
+    Image atlas = GenImageFontAtlas(font.glyphs,&font.recs,glyph_count,font_size,font.glyphPadding,0);
+    bool added = addFont(name,font,atlas);
+    UnloadImage(atlas);
+    for(int i = 0; i < glyph_count; i++)
+        UnloadImage(font.glyphs[i].image);
+    MemFree(font.glyphs);
+    MemFree(font.recs);
+    return added;
+}
+
+bool AssetPackBuilder::addImage(const char* name,Image image){
+    return add(name,ASSET_IMAGE,image) != nullptr;
+}
+
+// format converts uncompressed images ahead of time (0 keeps the source
+// format); already-compressed sources such as DDS or KTX are stored as-is.
+bool AssetPackBuilder::addImage(const char* name,const char* file_name,int format,bool mipmaps){
+    Image image = LoadImage(file_name);
+    if(image.data == nullptr){
+        cout << "Error: Image " << file_name << " could not be loaded" << endl;
+        return false;
+    }
+    bool compressed = image.format >= PIXELFORMAT_COMPRESSED_DXT1_RGB;
+    if(format != 0 && !compressed)
+        ImageFormat(&image,format);
+    if(mipmaps && !compressed)
+        ImageMipmaps(&image);
+    bool added = addImage(name,image);
+    UnloadImage(image);
+    return added;
+}
+
+bool AssetPackBuilder::write(const char* file_name){
+    FILE* file = fopen(file_name,"wb");
+    if(file == nullptr)
+        return false;
+    uint32_t count = assets.size();
+    uint64_t pos = asset_header_size + (uint64_t)count * sizeof(AssetEntry);
+    for(PendingAsset& asset : assets){
+        pos = (pos + 15) & ~(uint64_t)15;
+        asset.entry.pixels = pos;
+        asset.entry.pixels_size = asset.pixels.size();
+        pos += asset.pixels.size();
+        asset.entry.glyphs = asset.glyphs.empty() ? 0 : pos;
+        pos += asset.glyphs.size() * sizeof(PackedGlyph);
+    }
+    uint32_t reserved = 0;
+    fwrite(asset_magic,1,4,file);
+    fwrite(&asset_version,sizeof(asset_version),1,file);
+    fwrite(&count,sizeof(count),1,file);
+    fwrite(&reserved,sizeof(reserved),1,file);
+    for(PendingAsset& asset : assets)
+        fwrite(&asset.entry,sizeof(AssetEntry),1,file);
+    const char padding[16] = {};
+    for(PendingAsset& asset : assets){
+        long at = ftell(file);
+        fwrite(padding,1,asset.entry.pixels - at,file);
+        fwrite(asset.pixels.data(),1,asset.pixels.size(),file);
+        fwrite(asset.glyphs.data(),sizeof(PackedGlyph),asset.glyphs.size(),file);
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+AssetPack::AssetPack(){
+    data = nullptr;
+    length = 0;
+    mapped = false;
+    entries = nullptr;
+    count = 0;
+}
+
+AssetPack::~AssetPack(){
+    close();
+}
+
+bool AssetPack::open(const char* file_name){
+    close();
+#if !defined(_WIN32)
+    int fd = ::open(file_name,O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd,&info) == 0 && info.st_size > 0){
+        void* view = mmap(nullptr,info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(view != MAP_FAILED){
+            data = (const unsigned char*)view;
+            length = info.st_size;
+            mapped = true;
+        }
+    }
+    ::close(fd);
+#else
+    // windows.h clashes with raylib's names, so Windows reads the pack in one go.
+    unsigned int size = 0;
+    data = LoadFileData(file_name,&size);
+    length = size;
+#endif
+    if(data == nullptr)
+        return false;
+    uint32_t version = 0;
+    if(length >= asset_header_size){
+        memcpy(&version,data + 4,sizeof(version));
+        memcpy(&count,data + 8,sizeof(count));
+    }
+    if(length < asset_header_size || memcmp(data,asset_magic,4) != 0 || version != asset_version
+       || (length - asset_header_size) / sizeof(AssetEntry) < count){
+        cout << "Error: " << file_name << " is not an asset pack" << endl;
+        close();
+        return false;
+    }
+    entries = (const AssetEntry*)(data + asset_header_size);
+    for(uint32_t i = 0; i < count; i++){
+        if(!entryInBounds(entries[i],length)){
+            cout << "Error: " << file_name << " is truncated or corrupt" << endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetPack::close(){
+#if !defined(_WIN32)
+    if(mapped)
+        munmap((void*)data,length);
+#else
+    if(data != nullptr)
+        UnloadFileData((unsigned char*)data);
+#endif
+    data = nullptr;
+    length = 0;
+    mapped = false;
+    entries = nullptr;
+    count = 0;
+}
+
+bool AssetPack::isOpen(){
+    return data != nullptr;
+}
+
+size_t AssetPack::size(){
+    return count;
+}
+
+const AssetEntry* AssetPack::find(const char* name){
+    for(uint32_t i = 0; i < count; i++)
+        if(strncmp(entries[i].name,name,sizeof(AssetEntry::name)) == 0)
+            return &entries[i];
+    return nullptr;
+}
+
+Image AssetPack::image(const char* name){
+    const AssetEntry* e = find(name);
+    if(e == nullptr)
+        return Image{};
+    return Image{(void*)(data + e->pixels),e->width,e->height,e->mipmaps,e->format};
+}
+
+Texture AssetPack::loadTexture(const char* name){
+    Image view = image(name);
+    if(view.data == nullptr)
+        return Texture{};
+    return LoadTextureFromImage(view);
+}
+
+// Glyph metrics are copied into raylib-owned arrays so the font can be
+// released with UnloadFont like any other; glyph images are left empty
+// because drawing only uses the atlas.
+Font AssetPack::loadFont(const char* name){
+    Font font = {};
+    const AssetEntry* e = find(name);
+    if(e == nullptr || e->type != ASSET_FONT)
+        return font;
+    font.baseSize = e->base_size;
+    font.glyphCount = e->glyph_count;
+    font.glyphPadding = e->glyph_padding;
+    font.glyphs = (GlyphInfo*)MemAlloc(e->glyph_count * sizeof(GlyphInfo));
+    font.recs = (Rectangle*)MemAlloc(e->glyph_count * sizeof(Rectangle));
+    const PackedGlyph* glyphs = (const PackedGlyph*)(data + e->glyphs);
+    for(int i = 0; i < e->glyph_count; i++){
+        font.glyphs[i].value = glyphs[i].value;
+        font.glyphs[i].offsetX = glyphs[i].offset_x;
+        font.glyphs[i].offsetY = glyphs[i].offset_y;
+        font.glyphs[i].advanceX = glyphs[i].advance_x;
+        font.recs[i] = glyphs[i].rec;
+    }
+    font.texture = loadTexture(name);
+    return font;
+}
+
+UIContext::UIContext(){
+    root = nullptr;
+    font = Font{};
+    renderer = &raylib_renderer;
+    input = &raylib_input;
+    id_counter = 0;
+    ticking = false;
+    tick_list_dirty = false;
+    keyboard_focus = nullptr;
+    last_char = 0;
+    drag_focus = nullptr;
+    last_hover_pos = {-1,-1};
+    hover_dirty = true;
+    redraw = true;
+    layer_used = 0;
+    active_layer = nullptr;
+}
+
+void UIContext::makeCurrent(){
+    context = this;
+}
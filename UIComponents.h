@@ -1,10 +1,20 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <raylib.h>
+#include <thread>
 #include <iostream>
+#include <list>
 #include <stack>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -22,33 +32,556 @@ enum Allignment{
 };
 
 class Style;
+class Layer;
 class StaticContainer;
+class UIContext;
 
-stack<Rectangle> scissor_stack;
-StaticContainer* root;
-
-inline void DrawTextureToScreenCoords(Texture t,Vector2 pos,Vector2 dim){
-    DrawTexturePro(t,Rectangle{0,0,(float)t.width,(float)t.height},Rectangle{pos.x,pos.y,dim.x,dim.y},Vector2{0,0},0,WHITE);
-}
-
+void DrawTextureToScreenCoords(Texture t,Vector2 pos,Vector2 dim);
 void setScissor(Rectangle r);
 void endScissor();
+void renderFrame(Color clear=WHITE);
 void startGameLoop();
+void startFixedStepLoop(double update_rate=60,double render_rate=0);
+float glyphAdvance(int codepoint,float font_size,float spacing=2);
+void minMaxKernel(const float* lo,const float* hi,size_t n,float& mn,float& mx);
+void globalRectsKernel(const float* x,const float* y,size_t n,Vector2 origin,float* out_x,float* out_y);
+size_t pointInRectsKernel(const float* x,const float* y,const float* w,const float* h,size_t n,Vector2 point,unsigned char* hits);
+size_t clipRectsKernel(const float* x,const float* y,const float* w,const float* h,size_t n,Rectangle clip,unsigned char* visible);
+
+// Rectangles stored as separate x/y/width/height arrays for the kernels above.
+struct RectArray{
+    vector<float> x;
+    vector<float> y;
+    vector<float> w;
+    vector<float> h;
+    vector<unsigned char> mask;
+    void resize(size_t n);
+    size_t size();
+    size_t heapBytes();
+};
 
+class Renderer{
+public:
+    virtual ~Renderer();
+    virtual void beginFrame(Color clear) = 0;
+    virtual void endFrame() = 0;
+    virtual void beginScissor(Rectangle r) = 0;
+    virtual void endScissor() = 0;
+    virtual void drawRectangle(Rectangle r,Color color) = 0;
+    virtual void drawLine(Vector2 from,Vector2 to,Color color) = 0;
+    virtual void drawTexture(Texture texture,Rectangle source,Rectangle dest,Color tint) = 0;
+    virtual void drawText(const char* text,Vector2 position,float font_size,float spacing,Color color) = 0;
+    virtual void drawNinePatch(Texture texture,int corner,Rectangle dest,Color tint);
+    virtual Texture loadTexture(Image image);
+    virtual void unloadTexture(Texture texture);
+    virtual RenderTexture loadRenderTarget(int width,int height);
+    virtual void unloadRenderTarget(RenderTexture target);
+    virtual void beginRenderTarget(RenderTexture target,Color clear);
+    virtual void endRenderTarget();
+    virtual bool cachesLayers();
+    virtual void setTargetFPS(int fps);
+    virtual void close();
+};
+
+class RaylibRenderer: public Renderer{
+public:
+    void beginFrame(Color clear) override;
+    void endFrame() override;
+    void beginScissor(Rectangle r) override;
+    void endScissor() override;
+    void drawRectangle(Rectangle r,Color color) override;
+    void drawLine(Vector2 from,Vector2 to,Color color) override;
+    void drawTexture(Texture texture,Rectangle source,Rectangle dest,Color tint) override;
+    void drawText(const char* text,Vector2 position,float font_size,float spacing,Color color) override;
+    void drawNinePatch(Texture texture,int corner,Rectangle dest,Color tint) override;
+    RenderTexture loadRenderTarget(int width,int height) override;
+    void unloadRenderTarget(RenderTexture target) override;
+    void beginRenderTarget(RenderTexture target,Color clear) override;
+    void endRenderTarget() override;
+    bool cachesLayers() override;
+    void setTargetFPS(int fps) override;
+    void close() override;
+};
+
+struct RenderStats{
+    double record_ms;
+    double bin_ms;
+    double raster_ms;
+    double total_ms;
+    size_t commands;
+    int tiles;
+    int threads;
+};
+
+enum RasterCommandType{
+    RASTER_RECTANGLE,
+    RASTER_LINE,
+    RASTER_TEXTURE,
+};
+
+struct RasterCommand{
+    RasterCommandType type;
+    Rectangle dest;
+    Rectangle source;
+    Color color;
+    const Color* texels;
+    int texels_width;
+    int texels_height;
+    int x0 = 0,y0 = 0,x1 = 0,y1 = 0;
+};
+
+struct SoftwareTexture{
+    vector<Color> texels;
+    int width;
+    int height;
+};
+
+// Texture ids start at texture_id_base, far above the names a GPU hands out,
+// so drawTexture never mistakes a raylib texture for one of its own.
+// Frames covering fewer than parallel_pixels are rasterized on the calling
+// thread; larger ones are shared with a pool started on first use.
+class SoftwareRenderer: public Renderer{
+public:
+    static const int tile_size = 64;
+    static const unsigned int texture_id_base = 1u << 31;
+    static const long parallel_pixels = 64 * 64 * 4;
+    int width,height;
+    int threads;
+    vector<Color> pixels;
+    RenderStats stats;
+    SoftwareRenderer(int width,int height,int threads=0);
+    ~SoftwareRenderer();
+    void resize(int width,int height);
+    Texture loadTexture(Image image) override;
+    void unloadTexture(Texture texture) override;
+    void setFontAtlas(Image atlas);
+    Font loadFont(const char* file_name,int font_size,int glyph_count=95);
+    Image frame();
+    bool exportPNG(const char* file_name);
+    void beginFrame(Color clear) override;
+    void endFrame() override;
+    void beginScissor(Rectangle r) override;
+    void endScissor() override;
+    void drawRectangle(Rectangle r,Color color) override;
+    void drawLine(Vector2 from,Vector2 to,Color color) override;
+    void drawTexture(Texture texture,Rectangle source,Rectangle dest,Color tint) override;
+    void drawText(const char* text,Vector2 position,float font_size,float spacing,Color color) override;
+private:
+    Color clear_color;
+    Rectangle clip;
+    vector<RasterCommand> commands;
+    vector<vector<int>> bins;
+    map<unsigned int,SoftwareTexture> textures;
+    SoftwareTexture atlas;
+    unsigned int next_texture_id;
+    chrono::steady_clock::time_point frame_start;
+    vector<thread> pool;
+    mutex pool_lock;
+    condition_variable pool_wake;
+    condition_variable pool_idle;
+    long pool_generation;
+    int pool_busy;
+    bool pool_stop;
+    atomic<int> next_tile;
+    void push(RasterCommand command,Rectangle bounds);
+    void rasterizeTile(int tile);
+    void rasterizeTiles();
+    void poolWorker();
+};
+
+struct NineSliceKey{
+    Renderer* renderer;
+    int radius;
+    int thickness;
+    int blur;
+    bool operator<(const NineSliceKey& other) const;
+};
+
+struct NineSlice{
+    Texture texture;
+    int corner;
+    int inset;
+};
+
+// Rounded rectangles, rings and blurred shadows rasterized once in white and
+// tinted when drawn, so every size and color of a shape shares one small
+// texture that is stretched as a nine-patch.
+class NineSliceCache{
+public:
+    map<NineSliceKey,NineSlice> slices;
+    NineSlice& get(int radius,int thickness,int blur);
+    void draw(Rectangle shape,int radius,int thickness,int blur,Color tint);
+    void clear();
+    size_t bytes();
+};
+
+class InputSource{
+public:
+    virtual ~InputSource();
+    virtual void poll() = 0;
+    virtual void latch();
+    virtual bool wait(double seconds);
+    virtual bool done() = 0;
+    virtual double time() = 0;
+    virtual Vector2 mousePosition() = 0;
+    virtual bool isMouseButtonPressed(int button) = 0;
+    virtual bool isMouseButtonDown(int button) = 0;
+    virtual float mouseWheelMove() = 0;
+    virtual int keyPressed() = 0;
+    virtual bool isKeyDown(int key) = 0;
+};
+
+class RaylibInput: public InputSource{
+public:
+    RaylibInput();
+    void poll() override;
+    void latch() override;
+    bool wait(double seconds) override;
+    bool done() override;
+    double time() override;
+    Vector2 mousePosition() override;
+    bool isMouseButtonPressed(int button) override;
+    bool isMouseButtonDown(int button) override;
+    float mouseWheelMove() override;
+    int keyPressed() override;
+    bool isKeyDown(int key) override;
+private:
+    bool latched[3];
+    bool pending[3];
+    float latched_wheel;
+    float pending_wheel;
+    vector<int> latched_keys;
+    vector<int> pending_keys;
+    size_t next_key;
+};
+
+struct InputFrame{
+    double time;
+    Vector2 mouse;
+    unsigned char buttons;
+    float wheel;
+    vector<int> keys;
+    vector<int> down;
+    size_t next_key;
+};
+
+class InputFrameSource: public InputSource{
+public:
+    InputFrame frame;
+    InputFrameSource();
+    double time() override;
+    Vector2 mousePosition() override;
+    bool isMouseButtonPressed(int button) override;
+    bool isMouseButtonDown(int button) override;
+    float mouseWheelMove() override;
+    int keyPressed() override;
+    bool isKeyDown(int key) override;
+};
+
+class InputRecorder: public InputFrameSource{
+public:
+    InputSource* source;
+    size_t frames;
+    InputRecorder(const char* file_name,InputSource* source);
+    ~InputRecorder();
+    bool isOpen();
+    void poll() override;
+    void latch() override;
+    bool wait(double seconds) override;
+    bool done() override;
+private:
+    FILE* file;
+    double start_time;
+    double last_time;
+    template<class T> void put(T value);
+};
+
+class InputReplay: public InputFrameSource{
+public:
+    size_t frames;
+    InputReplay(const char* file_name);
+    bool isLoaded();
+    void poll() override;
+    bool done() override;
+private:
+    vector<unsigned char> data;
+    size_t pos;
+    template<class T> T get();
+};
+
+struct FrameTiming{
+    double update_ms;
+    double render_ms;
+};
+
+struct ReplayReport{
+    vector<FrameTiming> frames;
+    double total_ms;
+    double percentile(bool render,double p);
+    void print();
+    bool exportCSV(const char* file_name);
+};
+
+ReplayReport replayInput(const char* file_name);
+
+enum AssetType{
+    ASSET_FONT,
+    ASSET_IMAGE,
+};
+
+// On-disk pack entry. Offsets are from the start of the file and pixel data
+// is 16-byte aligned so it can be handed to the GPU straight from the mapping.
+struct AssetEntry{
+    char name[56];
+    uint32_t type;
+    int32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t mipmaps;
+    int32_t base_size;
+    int32_t glyph_count;
+    int32_t glyph_padding;
+    uint64_t pixels;
+    uint64_t pixels_size;
+    uint64_t glyphs;
+};
+
+struct PackedGlyph{
+    int32_t value;
+    int32_t offset_x;
+    int32_t offset_y;
+    int32_t advance_x;
+    Rectangle rec;
+};
+
+class AssetPackBuilder{
+public:
+    bool addFont(const char* name,const char* file_name,int font_size,int glyph_count=95);
+    bool addFont(const char* name,Font font,Image atlas);
+    bool addImage(const char* name,const char* file_name,int format=0,bool mipmaps=false);
+    bool addImage(const char* name,Image image);
+    bool write(const char* file_name);
+private:
+    struct PendingAsset{
+        AssetEntry entry;
+        vector<unsigned char> pixels;
+        vector<PackedGlyph> glyphs;
+    };
+    vector<PendingAsset> assets;
+    PendingAsset* add(const char* name,AssetType type,Image image);
+};
+
+// Read-only view of a pack written by AssetPackBuilder. The file is mapped
+// rather than read; images returned by image() point into the mapping and
+// stay valid until close().
+class AssetPack{
+public:
+    AssetPack();
+    ~AssetPack();
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+    bool open(const char* file_name);
+    void close();
+    bool isOpen();
+    size_t size();
+    const AssetEntry* find(const char* name);
+    Image image(const char* name);
+    Texture loadTexture(const char* name);
+    Font loadFont(const char* name);
+private:
+    const unsigned char* data;
+    size_t length;
+    bool mapped;
+    const AssetEntry* entries;
+    uint32_t count;
+};
+
+enum MemoryCategory{
+    MEMORY_COMPONENTS,
+    MEMORY_STYLES,
+    MEMORY_STRINGS,
+    MEMORY_CALLBACKS,
+    MEMORY_TEXTURES,
+    MEMORY_BUFFERS,
+    MEMORY_CATEGORY_COUNT,
+};
+
+struct MemoryReport{
+    static const char* category_names[MEMORY_CATEGORY_COUNT];
+    size_t bytes[MEMORY_CATEGORY_COUNT];
+    map<string,size_t> type_bytes;
+    map<string,size_t> type_counts;
+    string current_type;
+    size_t components;
+    long live_components;
+    long live_styles;
+    long live_timers;
+    long live_bindings;
+    MemoryReport();
+    void add(MemoryCategory category,size_t n);
+    void addComponent(const char* type,size_t size);
+    size_t total();
+    void print();
+};
+
+inline size_t heapBytes(const string& str){
+    return str.capacity() > 15 ? str.capacity() + 1 : 0;
+}
+
+template<class T>
+size_t heapBytes(const vector<T>& v){
+    return v.capacity() * sizeof(T);
+}
+
+class UIComponent;
+MemoryReport measureMemory(UIComponent* root);
+
+enum FramePhase{
+    PHASE_INPUT,
+    PHASE_UPDATE,
+    PHASE_DRAW,
+    PHASE_OTHER,
+    PHASE_COUNT,
+};
+
+struct AllocationSite{
+    void* address;
+    size_t count;
+    size_t bytes;
+};
+
+struct FrameAllocations{
+    size_t count[PHASE_COUNT];
+    size_t bytes[PHASE_COUNT];
+    size_t frees;
+    size_t total();
+    size_t totalBytes();
+};
+
+// Counts global operator new calls made on the thread that called start().
+// Debug builds also bucket them by return address, which print() lists for
+// addr2line. Counting needs UI_ALLOCATION_TRACKING defined before the
+// library is compiled, since it replaces the global operator new and
+// delete; without it every frame reports zero allocations.
+class AllocationTracker{
+public:
+    static const char* phase_names[PHASE_COUNT];
+    static const int max_sites = 256;
+    FramePhase phase;
+    bool in_frame;
+    FrameAllocations frame;
+    FrameAllocations last;
+    size_t frames;
+    size_t allocating_frames;
+    long steady_after;
+    AllocationSite sites[max_sites];
+    int site_count;
+    AllocationTracker();
+    ~AllocationTracker();
+    void start();
+    void stop();
+    bool tracking();
+    void setPhase(FramePhase phase);
+    void beginFrame();
+    void endFrame();
+    void requireSteadyState(int warmup_frames);
+    void record(size_t size,void* site);
+    void print();
+};
+
+class ObservableBase;
+
+class Binding{
+public:
+    static atomic<long> live_count;
+    ObservableBase* source;
+    int id;
+    Binding();
+    Binding(const Binding&) = delete;
+    Binding& operator=(const Binding&) = delete;
+    ~Binding();
+    bool bound();
+    void release();
+};
+
+class ObservableBase{
+public:
+    static void flush();
+    UIContext* context;
+    bool queued;
+    int next_id;
+    vector<Binding*> bindings;
+    ObservableBase();
+    virtual ~ObservableBase();
+    void schedule();
+    void attach(Binding* binding,int id);
+    void detach(Binding* binding);
+    virtual void unsubscribe(int id) = 0;
+    virtual void publish() = 0;
+};
+
+template<class T>
+class Observable: public ObservableBase{
+public:
+    T value;
+    T published;
+    vector<pair<int,std::function<void(const T&)>>> listeners;
+    Observable(T initial=T()):value(initial),published(initial){}
+    const T& get(){
+        return value;
+    }
+    void set(const T& v){
+        if(v == value)
+            return;
+        value = v;
+        schedule();
+    }
+    int subscribe(std::function<void(const T&)> listener){
+        int id = next_id++;
+        listeners.push_back({id,listener});
+        listener(value);
+        return id;
+    }
+    void subscribe(Binding& binding,std::function<void(const T&)> listener){
+        binding.release();
+        attach(&binding,subscribe(listener));
+    }
+    void unsubscribe(int id) override{
+        for(int i = 0; i < listeners.size(); i++){
+            if(listeners[i].first == id){
+                listeners.erase(listeners.begin() + i);
+                return;
+            }
+        }
+    }
+    void publish() override{
+        if(value == published)
+            return;
+        published = value;
+        for(int i = 0; i < listeners.size(); i++)
+            listeners[i].second(published);
+    }
+};
 
 class UIComponent {
 public:
-    static int id_counter;
     static Color default_background_color;
     static Color primary_color;
     static Color secondary_color;
+    static atomic<long> live_count;
+    static void tickAll();
+    UIContext* context;
     int id;
     int z_index;
+    int tick_index;
     vector<Style*> styles;
+    Layer* layer;
     UIComponent* parent; 
     Vector2 offset;
     Vector2 dimension;
     bool show;
+    bool static_storage;
+    static void release(UIComponent* c);
     UIComponent(UIComponent* parent, Vector2 offset, Vector2 dimension);
     virtual ~UIComponent(); 
     virtual void Draw() = 0;
@@ -58,30 +591,54 @@ public:
     Rectangle getGlobalBounds();
     void UIDraw();
     Vector2 getGlobalOffset();
+    void startTicking();
+    void stopTicking();
+    bool isTicking();
+    void invalidate();
+    void accountStyles(MemoryReport& report);
+    virtual void accountMemory(MemoryReport& report);
+    virtual float overdraw();
+    virtual bool suspendsUpdates();
 };
 
 class Style{
 public:
+    static atomic<long> live_count;
+    bool static_storage;
+    static void release(Style* s);
+    Style();
+    virtual ~Style();
+    virtual void accountMemory(MemoryReport& report);
     virtual void DrawBelow(UIComponent* c);
     virtual void DrawAbove(UIComponent* c);
     virtual void OnAdd(UIComponent* c);
+    virtual float overdraw();
 };
 
 class Border: public Style{ 
 public:
     int margin;
+    int radius;
     Color margin_color;
     bool U,D,L,R;
-    Border(int margin,Color margin_color);
+    Border(int margin,Color margin_color,int radius=0);
     void DrawAbove(UIComponent* c) override;
     void OnAdd(UIComponent* c) override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Background: public Style{
 public:
     Color color;
-    Background(Color background_color);
+    int radius;
+    int shadow_blur;
+    Vector2 shadow_offset;
+    Color shadow_color;
+    Background(Color background_color,int radius=0);
+    void setShadow(int blur,Vector2 offset={0,2},Color color={0,0,0,96});
     void DrawBelow(UIComponent* c) override;
+    void accountMemory(MemoryReport& report) override;
+    float overdraw() override;
 };
 
 class UIImage: public Style{
@@ -89,6 +646,7 @@ public:
     Texture texture;
     UIImage(Texture t);
     void DrawBelow(UIComponent* c) override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Clip: public Style{
@@ -98,6 +656,7 @@ public:
     Clip(Rectangle view,bool relative=false);
     void DrawBelow(UIComponent* c) override;
     void DrawAbove(UIComponent* c) override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Scroll: public Style{
@@ -108,12 +667,33 @@ public:
     Scroll(Rectangle view,Vector2 offset);
     void DrawBelow(UIComponent* c) override;
     void DrawAbove(UIComponent* c) override;
+    void accountMemory(MemoryReport& report) override;
+};
+
+class Layer: public Style{
+public:
+    static size_t budget;
+    UIContext* context;
+    Renderer* renderer;
+    RenderTexture texture;
+    bool loaded;
+    bool dirty;
+    list<Layer*>::iterator lru_pos;
+    Layer();
+    ~Layer();
+    void OnAdd(UIComponent* c) override;
+    void draw(UIComponent* c);
+    void evict();
+    size_t bytes();
+    void accountMemory(MemoryReport& report) override;
 };
 
 class KeyboardListener{
+protected:
+    static map<char,char> shift_map;
 public:
-    static KeyboardListener* focus;
-    static int last_char;
+    static char translateKey(int key);
+    UIContext* focus_context;
     KeyboardListener();
     ~KeyboardListener();
     bool isFocused();
@@ -134,9 +714,124 @@ public:
     bool Done();
 };
 
+enum TimerState{
+    TIMER_IDLE,
+    TIMER_QUEUED,
+    TIMER_DUE,
+};
+
+class Timer{
+public:
+    static atomic<long> live_count;
+    UIContext* context;
+    std::function<void()> callback;
+    double deadline;
+    double interval;
+    bool repeat;
+    TimerState state;
+    int slot;
+    Timer* prev;
+    Timer* next;
+    Timer(std::function<void()> callback=nullptr);
+    ~Timer();
+    void start(double delay,bool repeat=false);
+    void stop();
+    bool active();
+};
+
+class TimerWheel{
+private:
+    static const int slot_count = 256;
+    Timer* slots[slot_count];
+    vector<Timer*> due;
+    long current_tick;
+    int queued;
+public:
+    double resolution;
+    TimerWheel(double resolution=.004);
+    void schedule(Timer* t);
+    void unlink(Timer* t);
+    void advance(double now);
+    double nextDeadline();
+    int size();
+};
+
+enum Easing{
+    EASE_LINEAR,
+    EASE_IN,
+    EASE_OUT,
+    EASE_IN_OUT,
+};
+
+struct Tween{
+    void* target;
+    double start;
+    double duration;
+    Easing easing;
+    bool finished;
+    std::function<void(float)> apply;
+    std::function<void()> done;
+};
+
+class Animator{
+private:
+    vector<Tween*> tweens;
+    vector<Tween*> free_tweens;
+public:
+    ~Animator();
+    Tween* animate(double duration,std::function<void(float)> apply,Easing easing=EASE_OUT,void* target=nullptr);
+    Tween* animate(float* value,float to,double duration,Easing easing=EASE_OUT);
+    Tween* animate(Color* color,Color to,double duration,Easing easing=EASE_OUT);
+    void cancel(void* target);
+    void advance(double now);
+    bool active();
+};
+
+class Scheduler{
+public:
+    TimerWheel timers;
+    Animator animator;
+    double now;
+    Scheduler();
+    void advance(double now);
+    double nextDeadline();
+};
+
+class GameLoop{
+public:
+    bool fixed_step;
+    double update_rate;
+    double render_rate;
+    int max_steps;
+    double alpha;
+    int steps;
+    double update_ms;
+    double render_ms;
+    bool low_latency;
+    double idle_poll;
+    std::function<void(double alpha)> interpolate_callback;
+    GameLoop();
+    void pollInput();
+    void latchPointer();
+    void update(double now);
+    void render(double now);
+    void run();
+private:
+    void sampleInput();
+    bool idle();
+    void waitIdle();
+    Vector2 mouse_pos;
+    bool input_seen;
+    bool pressed[2];
+    bool down[2];
+    vector<int> keys;
+    Vector2 drag_origin;
+    int drag_button;
+};
+
 class Draggable{
 public:
-    static Draggable* focus;
+    UIContext* drag_context;
     Draggable();
     ~Draggable();
     virtual void onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button) = 0;
@@ -144,17 +839,28 @@ public:
 
 class MouseListener{
 public:
+    static void updateHover(MouseListener* root,Vector2 mouse_pos);
+    static void invalidateHover();
+    UIContext* listener_context;
     UIComponent* listener_parent;
+    bool hovered;
     MouseListener();
+    virtual ~MouseListener();
     void init();
     void UpdateClip();
     virtual bool onClick(Vector2 mouse_pos,MouseButton button);
     virtual bool onHover(Vector2 mouse_pos);
+    virtual void onMouseEnter();
+    virtual void onMouseLeave();
     bool Click(Vector2 mouse_pos,MouseButton button);
     bool Hover(Vector2 mouse_pos);
     bool operator<(const MouseListener& other) const;
 };
 
+// addComponent, detachComponent, removeComponent and clear change the tree
+// immediately. Handlers that run while the loop dispatches input, ticks or
+// observers must go through context->mutations instead, which applies the
+// changes after dispatch.
 class Container: public UIComponent, public MouseListener{
 public:
     vector<UIComponent*> components;
@@ -163,9 +869,11 @@ public:
     Container(Vector2 offset, Vector2 dimension,Layout l,Color background_color);
     ~Container();
     virtual void addComponent(UIComponent* component,bool fill=false) = 0;
-    void clear();
+    virtual void appendComponent(UIComponent* component);
+    virtual void clear();
     void addListener(MouseListener* listener);
     void addBoth(UIComponent* component);
+    virtual UIComponent* detachComponent(int id);
     bool removeComponent(int id);
     bool removeListener(int id);
     void Draw();
@@ -173,13 +881,23 @@ public:
     virtual bool setBounds(Vector2 offset, Vector2 dimension) = 0;
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
     bool onHover(Vector2 mouse_pos) override;
+    void accountMemory(MemoryReport& report) override;
+protected:
+    vector<UIComponent*> draw_order;
+    vector<MouseListener*> hit_order;
+    RectArray rects;
+    void sortHitOrder();
+    size_t hitTest(Vector2 mouse_pos);
 };
 
 class StaticContainer: public Container{
 public:
     StaticContainer(Vector2 offset, Vector2 dimension,Layout l,Color background_color=UIComponent::default_background_color);
     void addComponent(UIComponent* component, bool fill=false);
+    void appendComponent(UIComponent* component) override;
     bool setBounds(Vector2 offset, Vector2 dimension);
+    void relayout();
+    Vector2 contentExtent();
 };
 
 class DynamicContainer: public Container{
@@ -195,12 +913,16 @@ public:
     int size;
     Color text_color;
     Allignment a;
+    Binding binding;
     Text(Vector2 offset,string text,int font_size=20,Allignment a=LEFT,Color text_color=BLACK);
+    Text(Vector2 offset,Vector2 dimension,string text,int font_size=20,Allignment a=LEFT,Color text_color=BLACK);
     void Draw();
     void Update();
     bool setBounds(Vector2 offset, Vector2 dimension);
     Vector2 calculateDimension();
-    void setText(string text);
+    void setText(const string& text);
+    void bind(Observable<string>& cell);
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Box: public UIComponent{
@@ -209,6 +931,7 @@ public:
     void Draw();
     void Update();
     bool setBounds(Vector2 offset, Vector2 dimension);
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Button: public UIComponent, public MouseListener{
@@ -220,13 +943,18 @@ public:
     UIComponent* component;
     Color default_color;
     Button(UIComponent* c,std::function<void(Vector2 mouse_pos,MouseButton button)> click,Color col);
+    Button(UIComponent* c,Background* background,std::function<void(Vector2 mouse_pos,MouseButton button)> click);
     ~Button();
     void Draw();
     void Update();
     void addStyle(Style* style,int pos=-1) override;
+    float overdraw() override;
     bool setBounds(Vector2 offset, Vector2 dimension);
+    void fadeTo(Color to,double duration);
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
-    bool onHover(Vector2 mouse_pos) override;
+    void onMouseEnter() override;
+    void onMouseLeave() override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class TitleBar: public UIComponent, public MouseListener,public Draggable{
@@ -234,6 +962,9 @@ public:
     static int title_bar_height;
     StaticContainer* container;
     Background* background;
+    Text* title_name;
+    Box* spacer;
+    Button* close_button;
     string title;
     Vector2 start_drag;
     TitleBar(Vector2 offset, Vector2 dimension,string title);
@@ -245,15 +976,32 @@ public:
     bool onClick(Vector2 mouse_pos,MouseButton button);
     bool onHover(Vector2 mouse_pos);
     void onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button);
+    void accountMemory(MemoryReport& report) override;
+};
+
+enum ResizeEdge{
+    RESIZE_NONE = 0,
+    RESIZE_LEFT = 1,
+    RESIZE_RIGHT = 2,
+    RESIZE_TOP = 4,
+    RESIZE_BOTTOM = 8,
 };
 
-class Window: public UIComponent, public MouseListener{
+class Window: public UIComponent, public MouseListener, public Draggable{
 public:
+    static float resize_margin;
+    static Vector2 min_size;
     StaticContainer* content;
     StaticContainer* root_container;
     TitleBar* title_bar;
     Border* border;
     bool is_dragging;
+    bool opaque;
+    bool minimized;
+    bool occluded;
+    list<Window*>::iterator z_pos;
+    int resize_edges;
+    Rectangle start_bounds;
     Window(Vector2 offset, Vector2 dimension,string title);
     ~Window();
     void addComponent(UIComponent* component);
@@ -262,41 +1010,81 @@ public:
     void Draw();
     void Update();
     void Kill();
-    void addComponents();
+    void addComponents(string title);
     bool setBounds(Vector2 offset, Vector2 dimension);
+    Vector2 minimumSize();
+    bool suspendsUpdates() override;
+    int edgesAt(Vector2 mouse_pos);
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
     bool onHover(Vector2 mouse_pos) override;
+    void onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button) override;
+    void accountMemory(MemoryReport& report) override;
+};
+
+class WindowManager: public Container{
+public:
+    list<Window*> z_order;
+    bool cull_updates;
+    int culled;
+    WindowManager(Vector2 offset,Vector2 dimension);
+    void addComponent(UIComponent* component,bool fill=false) override;
+    UIComponent* detachComponent(int id) override;
+    void clear() override;
+    bool setBounds(Vector2 offset,Vector2 dimension) override;
+    void raise(Window* window);
+    void minimize(Window* window);
+    void restore(Window* window);
+    Window* top();
+    void Draw();
+    void Update();
+    bool onClick(Vector2 mouse_pos,MouseButton button) override;
+    bool onHover(Vector2 mouse_pos) override;
+    void accountMemory(MemoryReport& report) override;
+private:
+    vector<Rectangle> covers;
+    vector<Rectangle> pieces;
+    vector<Window*> draw_list;
+    bool covered(Rectangle r);
 };
 
 class TextBox: public UIComponent, public KeyboardListener, public MouseListener{
 private:
-    static int repeat_delay;
-    static int start_delay; 
-    static map<char,char> shift_map;
+    static double repeat_delay;
+    static double start_delay; 
+    static double blink_interval;
 public:
     Text* text;
     int padding;
     int cols;
     std::function<void(string str)> submit_callback;
     int cursor_pos;
-    Counter* frame_counter;
-    Counter* repeat_counter;
-    Counter* start_counter;
-    bool start_count_done;
+    Timer blink_timer;
+    Timer repeat_timer;
+    bool caret_visible;
+    int repeat_key;
     bool reset_on_enter;
     Background* background;
     Border* border;
+    Binding binding;
     TextBox(Vector2 offset, double font_size,int cols,std::function<void(string str)> submit_callback,bool reset,string str,Color text_color);
+    TextBox(Vector2 offset,Vector2 dimension,Text* text,int cols,std::function<void(string str)> submit_callback,Background* background,Border* border);
     ~TextBox();
     void Draw();
     void Update();
     bool setBounds(Vector2 offset, Vector2 dimension);
     Vector2 calculateDimension();
+    float caretX(int pos);
+    void resetCaret();
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
     void KeyPress(int key) override;
     void KeyRelease(int key) override;
     void KeyType(int key) override;
     void HandleKey(int key);
+    void bind(Observable<string>& cell);
+    void publish();
+    void accountMemory(MemoryReport& report) override;
+private:
+    void initTimers();
 };
 
 class CheckBox: public UIComponent, public MouseListener{
@@ -310,13 +1098,19 @@ public:
     Border* border;
     Color margin_color;
     bool checked;
+    Binding binding;
     CheckBox(Vector2 offset, Vector2 dimension,bool checked);
+    CheckBox(Vector2 offset,Vector2 dimension,bool checked,Background* background,Border* border);
     ~CheckBox();
     void Draw();
     void Update();
     bool setBounds(Vector2 offset, Vector2 dimension);
+    void bind(Observable<bool>& cell);
+    void setChecked(bool checked);
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
-    bool onHover(Vector2 mouse_pos) override;
+    void onMouseEnter() override;
+    void onMouseLeave() override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Field: public UIComponent,public MouseListener{
@@ -326,11 +1120,13 @@ public:
     Text* text;
     Box* spacer;
     Field(Vector2 pos,Vector2 dimension,string text,int cols,float font_size,std::function<void(string str)> submit,Color text_color);
+    Field(Vector2 pos,Vector2 dimension,Container* container,Text* text,TextBox* text_box);
     ~Field();
     bool onClick(Vector2 pos,MouseButton button) override;
     void Draw();
     void Update();
     bool setBounds(Vector2 pos,Vector2 dimension);
+    void accountMemory(MemoryReport& report) override;
 };
 
 class Slider: public UIComponent, public MouseListener, public Draggable{
@@ -343,13 +1139,16 @@ public:
     float slider_scale;
     float current;
     Layout l;
+    Binding binding;
     Slider(Vector2 offset,Vector2 dimension,std::function<void(float)> change_callback,float current=0, float slider_scale=.1,Layout l=VERTICAL);
     ~Slider();
     void Draw();
     void Update();
     bool setBounds(Vector2 offset,Vector2 dimensino);
+    void bind(Observable<float>& cell);
     bool onClick(Vector2 mouse_pos,MouseButton button) override;
     void onDrag(Vector2 mouse_pos,Vector2 delta,MouseButton button) override;
+    void accountMemory(MemoryReport& report) override;
 };
 
 class ScrollPane: public UIComponent, public MouseListener{
@@ -366,6 +1165,711 @@ public:
     bool setBounds(Vector2 offset,Vector2 dimesnion);
     bool onClick(Vector2 mouse_pos,MouseButton button) override; 
     bool onHover(Vector2 mouse_pos) override;
+    void accountMemory(MemoryReport& report) override;
+};
+
+
+class GapBuffer{
+public:
+    vector<char> buffer;
+    size_t gap_start;
+    size_t gap_end;
+    GapBuffer(size_t capacity=64);
+    size_t size();
+    char at(size_t pos);
+    void insert(size_t pos,const char* str,size_t n);
+    void erase(size_t pos,size_t n);
+    void copy(size_t pos,size_t n,char* out);
+    string substr(size_t pos,size_t n);
+    void clear();
+private:
+    void moveGap(size_t pos);
+    void grow(size_t needed);
+};
+
+// anchor is the line's start for lines before the LineTable gap and its
+// distance from the end of the text for lines after it.
+struct TextLine{
+    size_t anchor;
+    size_t length;
+    bool dirty;
+    vector<float> caret_x;
+};
+
+// Lines kept as a gap buffer. Lines after the gap are anchored to the end of
+// the text, so an edit at the gap moves them all by updating text_size, and
+// moving the gap costs only the lines it passes.
+class LineTable{
+public:
+    vector<TextLine> storage;
+    size_t gap_start;
+    size_t gap_end;
+    size_t text_size;
+    LineTable();
+    size_t size();
+    TextLine& operator[](size_t i);
+    size_t start(size_t i);
+    void moveGap(size_t i);
+    void insert(size_t i,vector<TextLine>& added);
+    void erase(size_t i);
+    void push_back(TextLine line);
+    void shift(long delta);
+    void clear(size_t text_size=0);
+private:
+    void grow(size_t needed);
+};
+
+class TextArea: public UIComponent, public KeyboardListener, public MouseListener{
+private:
+    static double repeat_delay;
+    static double start_delay;
+    static double blink_interval;
+    static int tab_width;
+public:
+    GapBuffer buffer;
+    LineTable lines;
+    string line_buffer;
+    float size;
+    float padding;
+    Color text_color;
+    int cursor_line;
+    int cursor_col;
+    float preferred_x;
+    int first_line;
+    float scroll_x;
+    Timer blink_timer;
+    Timer repeat_timer;
+    bool caret_visible;
+    int repeat_key;
+    Background* background;
+    Border* border;
+    TextArea(Vector2 offset,Vector2 dimension,float font_size=20,string str="",Color text_color=BLACK);
+    ~TextArea();
+    void Draw();
+    void Update();
+    bool setBounds(Vector2 offset,Vector2 dimension);
+    void setText(const string& str);
+    string getText();
+    void insertText(const char* str,size_t n);
+    void paste();
+    void eraseBefore();
+    void eraseAfter();
+    size_t cursorIndex();
+    int visibleLines();
+    void measureLine(int line);
+    int hitTestLine(int line,float x);
+    void scrollToCursor();
+    void moveLines(int delta);
+    void resetCaret();
+    bool onClick(Vector2 mouse_pos,MouseButton button) override;
+    void KeyPress(int key) override;
+    void KeyRelease(int key) override;
+    void KeyType(int key) override;
+    void HandleKey(int key);
+    void accountMemory(MemoryReport& report) override;
+};
+
+struct LogLine{
+    size_t start;
+    unsigned int length;
+    Color color;
+};
+
+class LogBuffer{
+public:
+    vector<char> data;
+    vector<LogLine> lines;
+    size_t first_line;
+    size_t line_count;
+    size_t bytes_written;
+    mutex lock;
+    atomic<bool> changed;
+    bool open_line;
+    LogBuffer(size_t max_lines,size_t max_bytes);
+    size_t size();
+    void append(const char* str,size_t n,Color color);
+    void append(const vector<string>& strs,Color color);
+    LogLine& line(size_t index);
+    void copy(const LogLine& line,size_t n,char* out);
+    void clear();
+private:
+    void writeBytes(const char* str,size_t n);
+    void pushLine(const char* str,size_t n,Color color);
+    void extendLine(const char* str,size_t n);
+};
+
+class LogView: public UIComponent, public MouseListener{
+public:
+    LogBuffer buffer;
+    Slider* scroll_bar;
+    Background* background;
+    string line_buffer;
+    string snapshot;
+    vector<LogLine> snapshot_lines;
+    float size;
+    float narrowest;
+    Color text_color;
+    size_t top_line;
+    bool follow;
+    LogView(Vector2 offset,Vector2 dimension,size_t max_lines=1000000,size_t max_bytes=64<<20,float font_size=16,Color text_color=BLACK);
+    ~LogView();
+    void append(const string& str);
+    void append(const string& str,Color color);
+    void append(const vector<string>& strs);
+    void clear();
+    int visibleLines();
+    void scrollTo(float percent);
+    void scrollLines(long delta);
+    void Draw();
+    void Update();
+    bool setBounds(Vector2 offset,Vector2 dimension);
+    bool onClick(Vector2 mouse_pos,MouseButton button) override;
+    void accountMemory(MemoryReport& report) override;
+};
+
+struct UICommand{
+    atomic<UICommand*> next;
+    std::function<void()> run;
+    chrono::steady_clock::time_point posted;
+};
+
+struct UICommandStats{
+    size_t depth;
+    size_t posted;
+    size_t executed;
+    size_t last_batch;
+    double last_latency_ms;
+    double max_latency_ms;
+    double avg_latency_ms;
+};
+
+// Lets worker threads hand mutations to the UI thread. A worker's own
+// context is not the UI's, so it must post to the queue of the context that
+// owns the components, captured before the worker starts (for example
+// component->context->command_queue).
+class UICommandQueue{
+private:
+    atomic<UICommand*> head;
+    UICommand* tail;
+    atomic<size_t> depth;
+    atomic<size_t> posted;
+    size_t executed;
+    size_t last_batch;
+    double last_latency_ms;
+    double max_latency_ms;
+    double total_latency_ms;
+public:
+    UICommandQueue();
+    ~UICommandQueue();
+    void post(std::function<void()> command);
+    void setText(Text* text,string str);
+    void setChecked(CheckBox* check_box,bool checked);
+    void toggle(CheckBox* check_box);
+    void addComponent(Container* container,UIComponent* component,bool listener=false);
+    void removeComponent(Container* container,int id);
+    void moveWindow(Window* window,Vector2 offset);
+    size_t drain(size_t max_commands=0);
+    bool empty();
+    UICommandStats stats();
+};
+
+enum MutationType{
+    MUTATION_ADD,
+    MUTATION_REMOVE,
+    MUTATION_REPARENT,
+    MUTATION_RAISE,
+    MUTATION_BOUNDS,
+};
+
+struct Mutation{
+    MutationType type;
+    Container* container;
+    UIComponent* component;
+    int id;
+    bool listener;
+    Vector2 offset = {0,0};
+    Vector2 dimension = {0,0};
+};
+
+// Structural changes queued during a frame and applied together by commit(),
+// so handlers can remove their own ancestors while dispatch is still walking
+// them. Detached components are destroyed only after every mutation has run,
+// and each touched container is relaid out and invalidated once per batch.
+class MutationQueue{
+private:
+    vector<Mutation> pending;
+    vector<Mutation> applying;
+    vector<Container*> touched;
+    vector<UIComponent*> graveyard;
+    void touch(UIComponent* component);
+    void attach(Mutation& m);
+public:
+    size_t committed;
+    size_t last_batch;
+    MutationQueue();
+    ~MutationQueue();
+    void add(Container* container,UIComponent* component,bool listener=false);
+    void remove(Container* container,int id);
+    void reparent(UIComponent* component,Container* container,bool listener=false);
+    void raise(Window* window);
+    void setBounds(UIComponent* component,Vector2 offset,Vector2 dimension);
+    bool empty();
+    size_t commit();
+};
+
+// Rows and cells are read on the UI thread. A source whose lessThan and
+// cellText may be called from several threads at once, with no writes in
+// between, can return true from concurrentReads to let DataGrid sort in
+// parallel.
+class GridDataSource{
+public:
+    virtual ~GridDataSource();
+    virtual size_t rowCount() = 0;
+    virtual int columnCount() = 0;
+    virtual void columnName(int col,string& out) = 0;
+    virtual void cellText(size_t row,int col,string& out) = 0;
+    virtual bool lessThan(size_t a,size_t b,int col);
+    virtual bool concurrentReads();
+};
+
+struct GridColumn{
+    string name;
+    vector<double> numbers;
+    vector<string> strings;
+    int precision;
+};
+
+class ColumnarDataSource: public GridDataSource{
+public:
+    vector<GridColumn> columns;
+    size_t rows;
+    ColumnarDataSource();
+    void addColumn(string name,vector<double> values,int precision=2);
+    void addColumn(string name,vector<string> values);
+    size_t rowCount() override;
+    int columnCount() override;
+    void columnName(int col,string& out) override;
+    void cellText(size_t row,int col,string& out) override;
+    bool lessThan(size_t a,size_t b,int col) override;
+    bool concurrentReads() override;
+};
+
+class DataGrid: public UIComponent, public MouseListener{
+private:
+    static Color header_color;
+    static Color grid_color;
+    static Color selected_color;
+public:
+    GridDataSource* source;
+    vector<float> column_widths;
+    vector<float> column_x;
+    vector<unsigned int> row_order;
+    Slider* v_scroll;
+    Slider* h_scroll;
+    Background* background;
+    string cell_buffer;
+    float size;
+    float row_height;
+    Color text_color;
+    int frozen_columns;
+    size_t first_row;
+    float scroll_x;
+    int sort_column;
+    bool sort_ascending;
+    long selected_row;
+    DataGrid(Vector2 offset,Vector2 dimension,GridDataSource* source,int frozen_columns=1,float font_size=16,Color text_color=BLACK);
+    ~DataGrid();
+    void setSource(GridDataSource* source);
+    void measureColumns(size_t sample_rows=64);
+    void setColumnWidth(int col,float width);
+    void sortBy(int col,bool ascending=true);
+    size_t rowAt(size_t visual_row);
+    int visibleRows();
+    int columnAt(float view_x);
+    void scrollRows(long delta);
+    void Draw();
+    void Update();
+    bool setBounds(Vector2 offset,Vector2 dimension);
+    bool onClick(Vector2 mouse_pos,MouseButton button) override;
+    void onMouseEnter() override;
+    void onMouseLeave() override;
+    void accountMemory(MemoryReport& report) override;
+private:
+    void updateColumns();
+    void sortRows();
+    void drawCellText(float x,float y,float width,Color color);
+    void drawColumn(int col,float x,Vector2 offset,size_t last_row,float view_height);
+};
+
+class PlotChannel{
+public:
+    static const int factor = 8;
+    vector<float> samples;
+    vector<vector<float>> mins;
+    vector<vector<float>> maxs;
+    size_t count;
+    Color color;
+    mutex lock;
+    atomic<bool> changed;
+    PlotChannel(size_t capacity,Color color);
+    void append(float sample);
+    void append(const float* data,size_t n);
+    size_t oldest();
+    int levelFor(double samples_per_pixel);
+    size_t blockSize(int level);
+    void range(size_t a,size_t b,int level,float& mn,float& mx);
+private:
+    void rawRange(size_t a,size_t b,float& mn,float& mx);
+    void updateBlocks(size_t from,size_t to);
+};
+
+class Plot: public UIComponent{
+public:
+    vector<PlotChannel*> channels;
+    size_t window;
+    float y_min;
+    float y_max;
+    bool auto_scale;
+    Plot(Vector2 offset,Vector2 dimension,size_t window,float y_min=0,float y_max=1);
+    ~Plot();
+    PlotChannel* addChannel(size_t capacity,Color color);
+    void append(int channel,const float* data,size_t n);
+    void Draw();
+    void Update();
+    bool setBounds(Vector2 offset,Vector2 dimension);
+    void accountMemory(MemoryReport& report) override;
+private:
+    void drawChannel(PlotChannel* channel,Vector2 offset,float lo,float hi);
+};
+
+class TreeDataSource{
+public:
+    virtual ~TreeDataSource();
+    virtual size_t root() = 0;
+    virtual size_t childCount(size_t node) = 0;
+    virtual size_t child(size_t node,size_t index) = 0;
+    virtual void label(size_t node,string& out) = 0;
+    virtual bool hasChildren(size_t node);
+};
+
+struct TreeNode{
+    size_t id;
+    TreeNode* parent;
+    size_t index;
+    int depth;
+    size_t child_count;
+    size_t visible;
+    map<size_t,TreeNode*> children;
+};
+
+struct TreeRow{
+    size_t id;
+    int depth;
+    TreeNode* parent;
+    size_t index;
+    TreeNode* node;
+};
+
+class TreeView: public UIComponent, public MouseListener{
+private:
+    static Color selected_color;
+    static float indent;
+public:
+    TreeDataSource* source;
+    TreeNode* root_node;
+    Slider* scroll_bar;
+    Background* background;
+    string label_buffer;
+    float size;
+    float row_height;
+    Color text_color;
+    size_t first_row;
+    long selected_row;
+    std::function<void(size_t node)> select_callback;
+    TreeView(Vector2 offset,Vector2 dimension,TreeDataSource* source,float font_size=16,Color text_color=BLACK);
+    ~TreeView();
+    void setSource(TreeDataSource* source);
+    size_t rowCount();
+    TreeRow row(size_t index);
+    bool expand(size_t index);
+    bool collapse(size_t index);
+    void toggle(size_t index);
+    int visibleRows();
+    void scrollRows(long delta);
+    void Draw();
+    void Update();
+    bool setBounds(Vector2 offset,Vector2 dimension);
+    bool onClick(Vector2 mouse_pos,MouseButton button) override;
+    void onMouseEnter() override;
+    void onMouseLeave() override;
+    void accountMemory(MemoryReport& report) override;
+private:
+    void deleteNode(TreeNode* node);
+    void addVisible(TreeNode* node,long delta);
+};
+
+class UIContext{
+public:
+    StaticContainer* root;
+    stack<Rectangle> scissor_stack;
+    Font font;
+    Renderer* renderer;
+    InputSource* input;
+    UICommandQueue command_queue;
+    MutationQueue mutations;
+    AllocationTracker allocations;
+    NineSliceCache nine_slices;
+    Scheduler scheduler;
+    GameLoop loop;
+    int id_counter;
+    vector<UIComponent*> tick_list;
+    bool ticking;
+    bool tick_list_dirty;
+    KeyboardListener* keyboard_focus;
+    int last_char;
+    Draggable* drag_focus;
+    vector<MouseListener*> hover_path;
+    vector<MouseListener*> last_hover_path;
+    Vector2 last_hover_pos;
+    bool hover_dirty;
+    bool redraw;
+    vector<ObservableBase*> dirty_observables;
+    size_t layer_used;
+    list<Layer*> layer_lru;
+    Layer* active_layer;
+    UIContext();
+    UIContext(const UIContext&) = delete;
+    UIContext& operator=(const UIContext&) = delete;
+    void makeCurrent();
+};
+
+template<class T>
+constexpr T fixedSum(initializer_list<T> values,size_t count=-1){
+    T sum = 0;
+    size_t i = 0;
+    for(T v : values){
+        if(i++ == count)
+            break;
+        sum += v;
+    }
+    return sum;
+}
+
+template<class T>
+constexpr T fixedMax(initializer_list<T> values){
+    T result = 0;
+    for(T v : values)
+        result = v > result ? v : result;
+    return result;
+}
+
+template<class Tuple>
+struct FixedInit{
+    Vector2 offset;
+    Tuple* values;
+};
+
+template<class C>
+void attachFixed(Container* container,C* c){
+    c->parent = container;
+    container->components.push_back(c);
+    if constexpr(is_base_of<MouseListener,C>::value)
+        container->listeners.push_back(c);
+}
+
+template<int W,int H,int FontSize=20,Allignment A=LEFT>
+struct FixedText{
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 1;
+    template<size_t I>
+    struct Storage{
+        Text component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :component(init.offset,{(float)W,(float)H},get<I>(*init.values),FontSize,A){
+            component.static_storage = true;
+        }
+    };
+};
+
+template<int W,int H,int FontSize=20>
+struct FixedButton{
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 2;
+    template<size_t I>
+    struct Storage{
+        Background background;
+        Text label;
+        Button component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :background(UIComponent::primary_color),
+         label(init.offset,{(float)W,(float)H},get<I>(*init.values),FontSize,MIDDLE),
+         component(&label,&background,get<I + 1>(*init.values)){
+            background.static_storage = true;
+            label.static_storage = true;
+            component.static_storage = true;
+            label.offset = {0,0};
+        }
+    };
+};
+
+template<int W,int H>
+struct FixedCheckBox{
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 1;
+    template<size_t I>
+    struct Storage{
+        Background background;
+        Border border;
+        CheckBox component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :background(BLANK),border(2,BLANK),
+         component(init.offset,{(float)W,(float)H},get<I>(*init.values),&background,&border){
+            background.static_storage = true;
+            border.static_storage = true;
+            component.static_storage = true;
+        }
+    };
+};
+
+// The label takes LabelW of the width and the text box the rest, so the
+// field needs no font measurement.
+template<int W,int H,int Cols,int FontSize=20,int LabelW=W / 2>
+struct FixedField{
+    static_assert(LabelW > 0 && LabelW < W,"A fixed field needs room for its label and text box");
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 2;
+    template<size_t I>
+    struct Storage{
+        Text label;
+        Text value;
+        Background background;
+        Border border;
+        TextBox text_box;
+        StaticContainer row;
+        Field component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :label({0,0},{(float)LabelW,(float)H},get<I>(*init.values),FontSize,LEFT),
+         value({5,0},{(float)(W - LabelW - 5),(float)H},"",FontSize,LEFT),
+         background(UIComponent::default_background_color),
+         border(2,UIComponent::secondary_color),
+         text_box({(float)LabelW,0},{(float)(W - LabelW),(float)H},&value,Cols,get<I + 1>(*init.values),&background,&border),
+         row({0,0},{(float)W,(float)H},HORIZONTAL),
+         component(init.offset,{(float)W,(float)H},&row,&label,&text_box){
+            label.static_storage = true;
+            value.static_storage = true;
+            background.static_storage = true;
+            border.static_storage = true;
+            text_box.static_storage = true;
+            row.static_storage = true;
+            component.static_storage = true;
+            row.components.reserve(2);
+            attachFixed(&row,&label);
+            attachFixed(&row,&text_box);
+        }
+    };
+};
+
+template<int W,int H>
+struct FixedSpacer{
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 0;
+    template<size_t I>
+    struct Storage{
+        Box component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :component({init.offset.x,init.offset.y,(float)W,(float)H}){
+            component.static_storage = true;
+        }
+    };
 };
 
+template<int W,int H,Layout L=FREE>
+struct FixedSlot{
+    static constexpr float width = W;
+    static constexpr float height = H;
+    static constexpr size_t args = 0;
+    template<size_t I>
+    struct Storage{
+        StaticContainer component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :component(init.offset,{(float)W,(float)H},L){
+            component.static_storage = true;
+        }
+    };
+};
+
+template<Layout L,class... Nodes>
+struct FixedStack{
+    static_assert(sizeof...(Nodes) > 0,"A fixed stack needs at least one child");
+    static constexpr float width = L == HORIZONTAL ? fixedSum<float>({Nodes::width...}) : fixedMax<float>({Nodes::width...});
+    static constexpr float height = L == VERTICAL ? fixedSum<float>({Nodes::height...}) : fixedMax<float>({Nodes::height...});
+    static constexpr size_t args = fixedSum<size_t>({Nodes::args...});
+    static constexpr Vector2 childOffset(size_t k){
+        return L == HORIZONTAL ? Vector2{fixedSum<float>({Nodes::width...},k),0} : Vector2{0,fixedSum<float>({Nodes::height...},k)};
+    }
+    template<size_t I,class Seq>
+    struct Children;
+    template<size_t I,size_t... K>
+    struct Children<I,index_sequence<K...>>{
+        tuple<typename Nodes::template Storage<I + fixedSum<size_t>({Nodes::args...},K)>...> items;
+        template<class Tuple>
+        Children(FixedInit<Tuple> init)
+        :items(FixedInit<Tuple>{childOffset(K),init.values}...){}
+        void attach(Container* container){
+            container->components.reserve(sizeof...(K));
+            (attachFixed(container,&get<K>(items).component),...);
+        }
+    };
+    template<size_t I>
+    struct Storage{
+        Children<I,index_sequence_for<Nodes...>> children;
+        StaticContainer component;
+        template<class Tuple>
+        Storage(FixedInit<Tuple> init)
+        :children(init),component(init.offset,{width,height},L){
+            component.static_storage = true;
+            children.attach(&component);
+        }
+        template<size_t K>
+        auto& child(){
+            return get<K>(children.items);
+        }
+    };
+};
+
+template<class... Nodes>
+using FixedRow = FixedStack<HORIZONTAL,Nodes...>;
+
+template<class... Nodes>
+using FixedColumn = FixedStack<VERTICAL,Nodes...>;
 
+struct FixedTag{};
+
+template<class Node>
+class FixedPanel{
+public:
+    typename Node::template Storage<0> root;
+    template<class... Args>
+    FixedPanel(Vector2 offset,Args&&... args)
+    :FixedPanel(FixedTag(),offset,forward_as_tuple(std::forward<Args>(args)...)){
+        static_assert(sizeof...(Args) == Node::args,"Wrong number of values for this fixed panel");
+    }
+    UIComponent* component(){
+        return &root.component;
+    }
+private:
+    template<class Tuple>
+    FixedPanel(FixedTag,Vector2 offset,Tuple values)
+    :root(FixedInit<Tuple>{offset,&values}){}
+};
@@ -11,8 +11,12 @@ int main(){
     InitWindow(800,600,"UI Test");
     SetTargetFPS(60);
 
-    font = LoadFontEx("res/RedHatMono-Medium.ttf",20,0,250);
-    if(font.texture.id == 0){
+    AssetPack pack;
+    if(pack.open("res/ui.pack"))
+        context->font = pack.loadFont("RedHatMono-Medium");
+    if(context->font.texture.id == 0)
+        context->font = LoadFontEx("res/RedHatMono-Medium.ttf",20,0,250);
+    if(context->font.texture.id == 0){
         cout << "Error: Font could not be loaded" << endl;
         return 1;
     }